@@ -0,0 +1,152 @@
+/*
+	drives an editor started with --server and prints how many edit commands a second it gets through
+
+	every round goes to a line, types a word, goes back and deletes it again so the file ends up
+	as it started, commands are sent a window at a time before the replies are read so the
+	socket is never empty, with a batch size over 1 they are sent in batches of that many
+
+	usage: loadgen SOCKET [OPS] [BATCH] [LINES]
+*/
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+/**** DEFINES ****/
+
+#define WINDOW 64 //replies that can be waiting before they are read
+#define ROUND_OPS 4 //goto, insert, goto, delete
+
+/**** DATA ****/
+
+typedef struct Reader {
+	int fd;
+	char buffer[4096];
+	int length;
+	int oks;
+	int errors;
+} Reader;
+
+/**** CLIENT ****/
+
+void die (const char* string) {
+	perror(string);
+	exit(1);
+}
+
+int connectTo (const char* path) {
+	struct sockaddr_un addr;
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	if (fd == -1) { die("socket"); }
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+	if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == -1) { die("connect"); }
+	return fd;
+}
+
+void sendAll (int fd, const char* data, size_t length) {
+	while (length > 0) {
+		ssize_t sent = write(fd, data, length);
+
+		if (sent <= 0) { die("write"); }
+		data += sent;
+		length -= sent;
+	}
+}
+
+//reads until count more replies are in, the first error is printed so a bad file shows up
+void readReplies (Reader* reader, int count) {
+	while (count > 0) {
+		char* newLine = memchr(reader->buffer, '\n', reader->length);
+		ssize_t nread;
+
+		if (newLine) {
+			*newLine = '\0';
+			if (strncmp(reader->buffer, "OK", 2) == 0) {
+				reader->oks++;
+			} else {
+				if (reader->errors++ == 0) { fprintf(stderr, "first error: %s\n", reader->buffer); }
+			}
+			reader->length -= newLine + 1 - reader->buffer;
+			memmove(reader->buffer, newLine + 1, reader->length);
+			count--;
+			continue;
+		}
+
+		nread = read(reader->fd, &reader->buffer[reader->length], sizeof(reader->buffer) - reader->length);
+		if (nread <= 0) { die("read"); }
+		reader->length += nread;
+	}
+}
+
+//the commands for one round, returns how long they are
+int makeRound (char* out, int line) {
+	return sprintf(out, "goto %d 1\ninsert loadgen\ngoto %d 1\ndelete 7\n", line, line);
+}
+
+double now () {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main (int argc, char* argv[]) {
+	Reader reader;
+	int ops = (argc > 2) ? atoi(argv[2]) : 100000;
+	int batch = (argc > 3) ? atoi(argv[3]) : 1;
+	int lines = (argc > 4) ? atoi(argv[4]) : 1;
+	char* out;
+	size_t outLength = 0;
+	int batched;
+	int waiting = 0; //replies not read yet
+	int round = 0;
+	int sent = 0;
+	double start, seconds;
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: loadgen SOCKET [OPS] [BATCH] [LINES]\n");
+		return 1;
+	}
+	if (lines < 1) { lines = 1; }
+	batched = batch > 1;
+	batch = batched ? (batch + ROUND_OPS - 1) / ROUND_OPS * ROUND_OPS : ROUND_OPS; //rounds arent split between batches
+
+	memset(&reader, 0, sizeof(reader));
+	reader.fd = connectTo(argv[1]);
+	out = malloc((size_t)WINDOW * (batch + 1) * 64);
+	if (out == NULL) { die("malloc"); }
+
+	start = now();
+	while (sent < ops) {
+		int i;
+
+		if (batched) { outLength += sprintf(&out[outLength], "batch %d\n", batch); }
+		for (i = 0; i < batch; i += ROUND_OPS) {
+			outLength += makeRound(&out[outLength], round++ % lines + 1);
+		}
+		waiting += batched ? 1 : batch; //a batch only gets the one reply
+		sent += batch;
+
+		if (waiting >= WINDOW || sent >= ops) {
+			sendAll(reader.fd, out, outLength);
+			outLength = 0;
+			readReplies(&reader, waiting);
+			waiting = 0;
+		}
+	}
+	seconds = now() - start;
+
+	printf("%d ops in %.3f s, %.0f ops/sec (%d ok, %d errors)\n", sent, seconds, sent / seconds, reader.oks, reader.errors);
+	free(out);
+	close(reader.fd);
+	return 0;
+}
@@ -0,0 +1,363 @@
+/*
+	reads syntax.db and writes syntax.h, the tables the editor highlights with
+
+	every language gets a table of 256 charicter classes so the lexer looks a byte up instead
+	of going through a chain of compares, and a perfect hash of its keywords so a word is
+	checked against one keyword at most
+
+	usage: syntaxgen syntax.db syntax.h
+*/
+
+#define _DEFAULT_SOURCE
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**** DEFINES ****/
+
+#define MAX_LANGUAGES 64
+#define MAX_KEYWORDS 512
+#define MAX_EXTENSIONS 16
+#define MAX_DISPLACEMENT 100000 //a bucket that cant be placed after this many tries makes the table bigger
+
+//the charicter classes, a byte can be more than one
+#define SYNTAX_SEPARATOR 1 //a number or keyword can start after one of these
+#define SYNTAX_DIGIT 2
+#define SYNTAX_WORD 4
+#define SYNTAX_QUOTE 8
+#define SYNTAX_COMMENT 16 //the first byte of a comment start
+#define SYNTAX_NUMBER 32 //can carry on a number once it has started
+
+/**** DATA ****/
+
+typedef struct Keyword {
+	char* word;
+	int kind; //1 for keywords, 2 for types
+	unsigned int bucket;
+} Keyword;
+
+typedef struct Language {
+	char* name;
+	char* extensions[MAX_EXTENSIONS];
+	int extensionCount;
+	char* lineComment;
+	char* blockStart;
+	char* blockEnd;
+	char* strings;
+	char* wordChars;
+	Keyword keywords[MAX_KEYWORDS];
+	int keywordCount;
+	int tableSize; //how big the keyword table came out
+	int bucketCount;
+} Language;
+
+Language languages[MAX_LANGUAGES];
+int languageCount = 0;
+
+/**** HASH ****/
+
+//this has to be the same as syntaxHash in tomsEditor.c
+unsigned int syntaxHash (unsigned int seed, const char* word, int length) {
+	unsigned int h = 2166136261u ^ (seed * 0x9e3779b1u);
+	int i;
+
+	for (i = 0; i < length; i++) {
+		h ^= (unsigned char)word[i];
+		h *= 16777619u;
+	}
+	h ^= h >> 15;
+	return h;
+}
+
+/**** PARSING ****/
+
+void die (const char* message, int lineNumber) {
+	fprintf(stderr, "syntaxgen: line %d: %s\n", lineNumber, message);
+	exit(1);
+}
+
+char* copyWord (const char* word) {
+	char* copy = strdup(word);
+
+	if (copy == NULL) { die("out of memory", 0); }
+	return copy;
+}
+
+void parseLine (char* line, int lineNumber) {
+	static Language* current = NULL;
+	char* directive = strtok(line, " \t\r\n");
+	char* word;
+
+	if (directive == NULL || directive[0] == '#') { return; }
+
+	if (strcmp(directive, "language") == 0) {
+		if (current) { die("language inside another language", lineNumber); }
+		if (languageCount == MAX_LANGUAGES) { die("too many languages", lineNumber); }
+		if ((word = strtok(NULL, " \t\r\n")) == NULL) { die("language needs a name", lineNumber); }
+
+		current = &languages[languageCount++];
+		memset(current, 0, sizeof(Language));
+		current->name = copyWord(word);
+		current->strings = copyWord("");
+		current->wordChars = copyWord("");
+		return;
+	}
+	if (current == NULL) { die("directive outside a language", lineNumber); }
+
+	if (strcmp(directive, "end") == 0) {
+		current = NULL;
+	} else if (strcmp(directive, "extensions") == 0) {
+		while ((word = strtok(NULL, " \t\r\n"))) {
+			if (current->extensionCount == MAX_EXTENSIONS - 1) { die("too many extensions", lineNumber); }
+			current->extensions[current->extensionCount++] = copyWord(word);
+		}
+	} else if (strcmp(directive, "line_comment") == 0) {
+		if ((word = strtok(NULL, " \t\r\n")) == NULL) { die("line_comment needs a start", lineNumber); }
+		current->lineComment = copyWord(word);
+	} else if (strcmp(directive, "block_comment") == 0) {
+		if ((word = strtok(NULL, " \t\r\n")) == NULL) { die("block_comment needs a start", lineNumber); }
+		current->blockStart = copyWord(word);
+		if ((word = strtok(NULL, " \t\r\n")) == NULL) { die("block_comment needs an end", lineNumber); }
+		current->blockEnd = copyWord(word);
+	} else if (strcmp(directive, "strings") == 0 || strcmp(directive, "word_chars") == 0) {
+		char** set = (directive[0] == 's') ? &current->strings : &current->wordChars;
+
+		if ((word = strtok(NULL, " \t\r\n")) == NULL) { die("needs some charicters", lineNumber); }
+		free(*set);
+		*set = copyWord(word);
+	} else if (strcmp(directive, "keywords") == 0 || strcmp(directive, "types") == 0) {
+		int kind = (directive[0] == 'k') ? 1 : 2;
+
+		while ((word = strtok(NULL, " \t\r\n"))) {
+			if (current->keywordCount == MAX_KEYWORDS) { die("too many keywords", lineNumber); }
+			current->keywords[current->keywordCount].word = copyWord(word);
+			current->keywords[current->keywordCount].kind = kind;
+			current->keywordCount++;
+		}
+	} else {
+		die("unknown directive", lineNumber);
+	}
+}
+
+/**** TABLES ****/
+
+void buildClasses (Language* language, unsigned char* classes) {
+	const char* p;
+	int c;
+
+	for (c = 0; c < 256; c++) {
+		classes[c] = 0;
+		if (isalpha(c) || c == '_' || c >= 128) { classes[c] |= SYNTAX_WORD; } //utf-8 bytes are taken as part of words
+		if (isdigit(c)) { classes[c] |= SYNTAX_DIGIT | SYNTAX_NUMBER; }
+		if (strchr("xXabcdefABCDEFuUlL._", c) && c != 0) { classes[c] |= SYNTAX_NUMBER; }
+	}
+	for (p = language->wordChars; *p; p++) { classes[(unsigned char)*p] |= SYNTAX_WORD; }
+	for (p = language->strings; *p; p++) { classes[(unsigned char)*p] |= SYNTAX_QUOTE; }
+	if (language->lineComment) { classes[(unsigned char)language->lineComment[0]] |= SYNTAX_COMMENT; }
+	if (language->blockStart) { classes[(unsigned char)language->blockStart[0]] |= SYNTAX_COMMENT; }
+
+	for (c = 0; c < 256; c++) {
+		if (!(classes[c] & (SYNTAX_WORD | SYNTAX_DIGIT))) { classes[c] |= SYNTAX_SEPARATOR; }
+	}
+}
+
+/*
+	hash and displace, every keyword goes in a bucket by its hash with seed 0, then the biggest
+	buckets first each look for a seed that puts all their keywords in empty slots
+	looking a word up is then two hashes and one compare, returns 0 if some bucket wouldnt fit
+*/
+int buildPerfectHash (Language* language, int tableSize, int bucketCount, int* slots, unsigned int* displacements) {
+	int* bucketSizes = calloc(bucketCount, sizeof(int));
+	int* order = malloc(sizeof(int) * bucketCount);
+	int* tried = malloc(sizeof(int) * language->keywordCount);
+	int i, j, b;
+
+	if (bucketSizes == NULL || order == NULL || tried == NULL) { die("out of memory", 0); }
+
+	for (i = 0; i < tableSize; i++) { slots[i] = -1; }
+	for (i = 0; i < language->keywordCount; i++) {
+		Keyword* k = &language->keywords[i];
+
+		k->bucket = syntaxHash(0, k->word, strlen(k->word)) % bucketCount;
+		bucketSizes[k->bucket]++;
+	}
+
+	//biggest buckets first, they are the hardest to fit
+	for (b = 0; b < bucketCount; b++) { order[b] = b; }
+	for (b = 1; b < bucketCount; b++) {
+		int bucket = order[b];
+
+		for (j = b; j > 0 && bucketSizes[order[j - 1]] < bucketSizes[bucket]; j--) { order[j] = order[j - 1]; }
+		order[j] = bucket;
+	}
+
+	for (b = 0; b < bucketCount && bucketSizes[order[b]] > 0; b++) {
+		unsigned int seed;
+		int placed = 0;
+
+		for (seed = 1; seed < MAX_DISPLACEMENT && !placed; seed++) {
+			int count = 0;
+
+			placed = 1;
+			for (i = 0; i < language->keywordCount && placed; i++) {
+				Keyword* k = &language->keywords[i];
+				int slot;
+
+				if (k->bucket != (unsigned int)order[b]) { continue; }
+				slot = syntaxHash(seed, k->word, strlen(k->word)) & (tableSize - 1);
+				if (slots[slot] != -1) { placed = 0; }
+				for (j = 0; j < count && placed; j++) {
+					if (tried[j] == slot) { placed = 0; }
+				}
+				tried[count++] = slot;
+			}
+
+			if (!placed) { continue; }
+			displacements[order[b]] = seed;
+			count = 0;
+			for (i = 0; i < language->keywordCount; i++) {
+				if (language->keywords[i].bucket == (unsigned int)order[b]) { slots[tried[count++]] = i; }
+			}
+		}
+		if (!placed) { break; }
+	}
+
+	i = (b == bucketCount || bucketSizes[order[b]] == 0);
+	free(bucketSizes);
+	free(order);
+	free(tried);
+	return i;
+}
+
+/**** OUTPUT ****/
+
+void writeString (FILE* out, const char* string) {
+	if (string == NULL) {
+		fprintf(out, "NULL");
+		return;
+	}
+	fputc('"', out);
+	for (; *string; string++) {
+		if (*string == '"' || *string == '\\') { fputc('\\', out); }
+		fputc(*string, out);
+	}
+	fputc('"', out);
+}
+
+void writeLanguage (FILE* out, Language* language, int n) {
+	unsigned char classes[256];
+	int tableSize = 16;
+	int bucketCount = language->keywordCount / 4 + 1;
+	int* slots;
+	unsigned int* displacements;
+	int i, j;
+
+	//duplicates would never fit in the table
+	for (i = 0; i < language->keywordCount; i++) {
+		for (j = i + 1; j < language->keywordCount; j++) {
+			if (strcmp(language->keywords[i].word, language->keywords[j].word) == 0) {
+				fprintf(stderr, "syntaxgen: %s has %s twice\n", language->name, language->keywords[i].word);
+				exit(1);
+			}
+		}
+	}
+
+	buildClasses(language, classes);
+	fprintf(out, "static const unsigned char syntaxClasses%d[256] = {", n);
+	for (i = 0; i < 256; i++) { fprintf(out, "%s%d,", (i % 16) ? " " : "\n\t", classes[i]); }
+	fprintf(out, "\n};\n\n");
+
+	fprintf(out, "static const char* const syntaxExtensions%d[] = {", n);
+	for (i = 0; i < language->extensionCount; i++) {
+		writeString(out, language->extensions[i]);
+		fprintf(out, ", ");
+	}
+	fprintf(out, "NULL};\n\n");
+
+	while (tableSize < language->keywordCount * 2) { tableSize *= 2; }
+	while (1) {
+		slots = malloc(sizeof(int) * tableSize);
+		displacements = calloc(bucketCount, sizeof(unsigned int));
+		if (slots == NULL || displacements == NULL) { die("out of memory", 0); }
+		if (buildPerfectHash(language, tableSize, bucketCount, slots, displacements)) { break; }
+		free(slots);
+		free(displacements);
+		tableSize *= 2;
+	}
+
+	fprintf(out, "static const unsigned int syntaxDisplacements%d[%d] = {", n, bucketCount);
+	for (i = 0; i < bucketCount; i++) { fprintf(out, "%s%u,", (i % 8) ? " " : "\n\t", displacements[i]); }
+	fprintf(out, "\n};\n\n");
+
+	fprintf(out, "static const SyntaxKeyword syntaxKeywords%d[%d] = {\n", n, tableSize);
+	for (i = 0; i < tableSize; i++) {
+		if (slots[i] == -1) {
+			fprintf(out, "\t{NULL, 0, 0},\n");
+			continue;
+		}
+		fprintf(out, "\t{");
+		writeString(out, language->keywords[slots[i]].word);
+		fprintf(out, ", %d, %d},\n", (int)strlen(language->keywords[slots[i]].word), language->keywords[slots[i]].kind);
+	}
+	fprintf(out, "};\n\n");
+
+	free(slots);
+	free(displacements);
+	language->tableSize = tableSize;
+	language->bucketCount = bucketCount;
+}
+
+int main (int argc, char* argv[]) {
+	char line[4096];
+	int lineNumber = 0;
+	FILE* in;
+	FILE* out;
+	int i;
+
+	if (argc != 3) {
+		fprintf(stderr, "usage: syntaxgen syntax.db syntax.h\n");
+		return 1;
+	}
+	if ((in = fopen(argv[1], "r")) == NULL) {
+		perror(argv[1]);
+		return 1;
+	}
+	while (fgets(line, sizeof(line), in)) { parseLine(line, ++lineNumber); }
+	fclose(in);
+
+	if ((out = fopen(argv[2], "w")) == NULL) {
+		perror(argv[2]);
+		return 1;
+	}
+
+	fprintf(out, "/* made by syntaxgen from %s, change that and run make instead of editing this */\n\n", argv[1]);
+	fprintf(out, "#define SYNTAX_SEPARATOR %d\n", SYNTAX_SEPARATOR);
+	fprintf(out, "#define SYNTAX_DIGIT %d\n", SYNTAX_DIGIT);
+	fprintf(out, "#define SYNTAX_WORD %d\n", SYNTAX_WORD);
+	fprintf(out, "#define SYNTAX_QUOTE %d\n", SYNTAX_QUOTE);
+	fprintf(out, "#define SYNTAX_COMMENT %d\n", SYNTAX_COMMENT);
+	fprintf(out, "#define SYNTAX_NUMBER %d\n\n", SYNTAX_NUMBER);
+
+	for (i = 0; i < languageCount; i++) { writeLanguage(out, &languages[i], i); }
+
+	fprintf(out, "static const SyntaxLanguage syntaxLanguages[] = {\n");
+	for (i = 0; i < languageCount; i++) {
+		Language* language = &languages[i];
+
+		fprintf(out, "\t{");
+		writeString(out, language->name);
+		fprintf(out, ", syntaxExtensions%d, syntaxClasses%d, ", i, i);
+		writeString(out, language->lineComment);
+		fprintf(out, ", ");
+		writeString(out, language->blockStart);
+		fprintf(out, ", ");
+		writeString(out, language->blockEnd);
+		fprintf(out, ", syntaxKeywords%d, %d, syntaxDisplacements%d, %d},\n", i, language->tableSize - 1, i, language->bucketCount);
+	}
+	fprintf(out, "};\n\n#define SYNTAX_LANGUAGE_COUNT %d\n", languageCount);
+
+	fclose(out);
+	return 0;
+}
@@ -11,11 +11,29 @@
 #include <string.h>
 #include <sys/ioctl.h>
 #include <sys/types.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <poll.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <signal.h>
+#include <stdint.h>
 #include <termios.h>
 #include <unistd.h>
 #include <time.h>
 #include <stdarg.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <zlib.h>
+#ifdef TOMS_ZSTD
+#include <zstd.h>
+#endif
 
 #include <limits.h>
 
@@ -33,8 +51,185 @@
 
 #define TAB_SIZE 8 
 
+#define ROW_INDEX_STEP 128 //rows keep a column checkpoint every this many raw bytes
+
+#define LONG_ROW_THRESHOLD (1 << 16) //rows longer than this are stored in chunks
+#define LONG_ROW_CHUNK (1 << 14) //chunks are filled to this size and split at twice it
+
+#define GAP_SIZE 64 //how big the gap is when a row is first typed in, it doubles when it fills up
+
+#define INGEST_CHUNK_SIZE (1 << 16) //how many bytes the stream reader pulls off a pipe at a time
+
+#define BRACKET_KINDS 3 //(), [] and {} are matched seperately
+
+#define PARALLEL_MAX_THREADS 64 //the most threads a parallel pass over the rows will use
+
+#define SYNC_BLOCK_MASK 63 //a block of rows ends after a row whose hash has all these bits set, about 64 rows
+#define SYNC_BLOCK_MAX 1024 //or once it has this many rows
+
+#define INDEX_CACHE_MIN_SIZE (1 << 24) //files this big get their line offsets cached so they open quicker next time
+#define INDEX_CACHE_SAMPLES 64 //how many pieces of the file are hashed to check the cache is for it
+#define INDEX_CACHE_SAMPLE_SIZE 4096
+#define INDEX_INGEST_BATCH 4096 //rows added from the cache each time the lock is taken
+
+#define HEX_LINE_BYTES 16 //how many bytes each line of the hex view shows
+#define HEX_SNIFF_SIZE (1 << 16) //a nul byte in this much of the start of a file opens it as hex
+#define HEX_FIND_CHUNK (1 << 20) //the mapping is searched in pieces this big, split between threads
+#define HEX_NOT_FOUND ((size_t)-1)
+#define HEX_PAGE_SIZE 4096 //typed over bytes are marked a page at a time and whole pages are written when saved
+
+#define FUZZY_TOP_K 16 //how many of the best matches the fuzzy finder keeps and shows
+#define FUZZY_CHUNK_ROWS 4096 //rows a scoring thread takes at a time, it checks for a newer query between them
+#define FUZZY_SCORE_MATCH 16
+#define FUZZY_SCORE_CONSECUTIVE 12 //a letter straight after the last one that matched
+#define FUZZY_SCORE_BOUNDARY 8 //a letter at the start of a word
+
+#define SEARCH_TEXT_MAX 512 //how much of a matching line goes in its result row
+#define SEARCH_FLUSH_SIZE (1 << 16) //a file with lots of matches hands them over in pieces this big
+#define SEARCH_SCAN_WINDOW (1 << 30) //editorFindInText takes an int so big files are scanned in windows
+
+#define WORD_MAX_LENGTH 64 //longer words are counted but not put in the word index
+#define WORD_INDEX_BATCH 4096 //rows the background indexer does each time it takes the lock
+#define WORD_REINDEX_MAX (1 << 20) //rows longer than this keep the words they had when they are changed
+#define WORD_COMPLETE_MAX 16
+
+#define SERVER_MAX_CLIENTS 16
+#define SERVER_READ_SIZE 4096
+#define SERVER_MAX_BATCH 4096
+#define SERVER_MAX_BUFFER (4 << 20) //a client with more than this sent that cant be run yet is dropped
+
+#define CLIPBOARD_OSC52_MAX (1 << 17) //copies bigger than this arent sent to the terminal, most terminals drop them anyway
+#define CLIPBOARD_WRITE_SIZE (1 << 16) //the clipboard is written to a file in pieces this big
+
 /**** DATA ****/
 
+/*
+	how a piece of text changes the bracket depth, for each kind of bracket
+	sum is opens take away closes, minPrefix is the lowest the depth gets reading forwards
+	and maxSuffix is the most opens left over in any piece that runs to the end
+*/
+typedef struct BracketSummary {
+	int sum[BRACKET_KINDS];
+	int minPrefix[BRACKET_KINDS];
+	int maxSuffix[BRACKET_KINDS];
+} BracketSummary;
+
+/*
+	the file is split into blocks of rows so a changed file can be matched up against what was
+	loaded, blocks end where the content says so an inserted line only changes the blocks round it
+*/
+typedef struct SyncBlock {
+	uint64_t hash;
+	int rows;
+	off_t offset; //where the block starts in the file, only kept for a file being reloaded
+} SyncBlock;
+
+/*
+	a node in the ternary search tree of words, lo and hi are words with a smaller or bigger
+	letter here and eq carries on the word, count is how many times the word ending here is used
+	nodes are kept in one array and linked by index so it can grow, 0 is no node
+*/
+typedef struct WordNode {
+	unsigned char c;
+	int count;
+	int best; //the most any word on or under this node is used, 0 if none of them are
+	int lo;
+	int eq; //the next free node when this one is free
+	int hi;
+	int parent;
+} WordNode;
+
+/*
+	a node of the row tree, a treap with one node for each row kept in the same order as the
+	rows, so rows can be put in and taken out in log n and the totals of a range can be read
+	without walking it, size is how many rows are under the node and it counts itself
+	dirty means a row under it changed and the totals need adding up again before they are read
+*/
+typedef struct RowNode {
+	int left;
+	int right;
+	int parent;
+	int size;
+	int priority; //random, a node is always above the nodes with smaller ones so the tree stays balanced
+	int dirty;
+	BracketSummary brackets; //of all the rows under the node
+	int visible; //how many of them arent hidden in a fold
+	int wrapLines; //the screen lines the ones that are shown take up when wrapping
+} RowNode;
+
+//a connection to the command server and the part of a command it has sent so far
+typedef struct ServerClient {
+	int fd; //-1 when the slot is free
+	char* buffer;
+	size_t length;
+	size_t capacity;
+} ServerClient;
+
+//a row the fuzzy finder matched and how well
+typedef struct FuzzyMatch {
+	int score;
+	int row;
+} FuzzyMatch;
+
+//a byte the hex view typed over and what it was before, so ctrl-z can put it back
+typedef struct HexEdit {
+	size_t offset;
+	unsigned char old;
+} HexEdit;
+
+//the line offsets of a big file as they are found, written out as the index cache once it has been read
+typedef struct IndexBuilder {
+	uint64_t* offsets;
+	size_t count;
+	size_t capacity;
+} IndexBuilder;
+
+/*
+	a language the editor can highlight, these come from syntax.db and are turned into
+	syntax.h by syntaxgen when make runs
+	classes has the SYNTAX_ flags for each byte, keywords is a perfect hash table that is
+	looked up through displacements, so a word is only ever compared with one keyword
+*/
+typedef struct SyntaxKeyword {
+	const char* word;
+	int length;
+	int kind; //1 for keywords, 2 for types
+} SyntaxKeyword;
+
+typedef struct SyntaxLanguage {
+	const char* name;
+	const char* const* extensions; //ends with NULL
+	const unsigned char* classes;
+	const char* lineComment;
+	const char* blockStart;
+	const char* blockEnd;
+	const SyntaxKeyword* keywords;
+	unsigned int keywordMask;
+	const unsigned int* displacements;
+	unsigned int bucketCount;
+} SyntaxLanguage;
+
+#include "syntax.h"
+
+/*
+	the raw text of a row that the clipboard or undo also holds, so copying a row only
+	takes a referance to its text instead of copying it, refs counts the row too
+	the text never changes while it is shared, a row copies it first before it is edited
+*/
+typedef struct SharedText {
+	int refs;
+	char* rawChars;
+	int rawLength;
+	struct LongRow* longRow; //set instead of rawChars for a long row
+} SharedText;
+
+//a piece of a line of shared text, the clipboard is one of these for each line
+typedef struct TextSlice {
+	SharedText* text;
+	int start;
+	int length;
+} TextSlice;
+
 typedef struct EditorRow {
 	//these are the charictors that are acutally renderd on screen
     int length;
@@ -47,13 +242,104 @@ typedef struct EditorRow {
     	shows if that char is in a string, number ect
     */
     unsigned char* hl;
+    
+    /*
+    	cols is how many screen columns the row takes up, this is not the same as length
+    	once tabs and utf-8 are in the row
+    	index holds a checkpoint every ROW_INDEX_STEP raw bytes so mapping between raw
+    	positions and columns only walks a few bytes, it is NULL for rows shorter than a step
+    */
+    int cols;
+    struct RowIndexEntry* index;
+    
+    /*
+    	rows longer than LONG_ROW_THRESHOLD keep their raw text in chunks instead of rawChars,
+    	chars and hl then only hold the part of the row that is on screen
+    */
+    struct LongRow* longRow;
+    int windowCol; //the column chars[0] is at for a long row or the row being typed in
+    
+    /*
+    	the row the cursor is typing in has a gap at the cursor so typing and deleting dont
+    	move the rest of the row, rawLength does not count the gap
+    	only the first indexLength checkpoints are right while the row has a gap
+    */
+    int hasGap;
+    int gapStart;
+    int gapLength;
+    int indexLength;
+    int gapCommentFrom; //the start state hlOpenComment was last worked out from while the row has a gap, -1 once an edit might have changed it
+    
+    BracketSummary brackets;
+    int treeNode; //the row's node in the row tree
+    
+    int hidden; //inside a fold so it isnt drawn
+    int foldedRows; //how many rows after this one are folded behind it
+    
+    int hlOpenComment; //the row ends inside a block comment, so the next one starts in it
+    
+    int wrapLines; //how many screen lines the row takes up when long lines are wrapped
+    int filtered; //one of the rows the filter shows
+    
+    //what the row added to the word index, so it can be taken back out when the row changes
+    int* wordIds;
+    int wordIdCount;
+    int wordTotal;
+    int charTotal;
+    
+    SharedText* shared; //the raw text is also held by the clipboard or undo, NULL when the row is the only owner
 } EditorRow;
 
+//a point in a row where a charicter starts, in raw bytes, rendered bytes and screen columns
+typedef struct RowIndexEntry {
+	int raw;
+	int render;
+	int col;
+} RowIndexEntry;
+
+/*
+	a piece of a long row, chunks always start on a charicter so nothing is split between two
+	widths is how many columns the chunk takes up when it starts on a column that
+	is 0..TAB_SIZE-1 past a tab stop, so the columns can be added up without walking the text
+*/
+typedef struct RowChunk {
+	char* data;
+	int length;
+	int startRaw;
+	int startCol;
+	int widths[TAB_SIZE];
+	BracketSummary brackets;
+	int dirty; //widths need working out again
+} RowChunk;
+
+typedef struct LongRow {
+	RowChunk* chunks;
+	int count;
+	int capacity;
+} LongRow;
+
+/*
+	every edit saves what it changed so ctrl-z can put it back, records with the same group
+	are undone together, so a replace all or a run of typing on one row is a single undo
+*/
+typedef struct UndoRecord {
+	int group;
+	int type;
+	int row;
+	char* text; //the row as it was before, for changed and deleted rows
+	int length;
+	int cx, cy, xScroll, yScroll; //where the cursor was so undo can put it back
+	int count; //how many rows for the types that do lots of rows at once
+	TextSlice* slices; //the rows that were deleted, they share their text so a big cut isnt copied
+} UndoRecord;
+
 struct EditorConfig {
     int cx, cy; //this is for cursor location
     int screenRows;
     int screenCols;
     int numberOfRows; //number of rows in the current file
+    int rowsCapacity; //how many rows have been allocated, grows by doubling
+    int gapRow; //the row that has a gap buffer open, -1 if there is none
     int yScroll;
     int xScroll;
     EditorRow* rows;
@@ -62,9 +348,179 @@ struct EditorConfig {
     
     char* filePath;
     size_t filePathLength;
+    int fileCompression; //files opened compressed are saved compressed the same way
+    const SyntaxLanguage* syntax; //picked by the file name, NULL only highlights numbers
     
     char statusMsg[80];
   	time_t statusMsgTime;
+  	
+  	/*
+  		rowsLock guards rows and numberOfRows, the ui thread holds it all the time
+  		apart from when it is waiting for a key, this is when the stream reader gets to add rows
+  	*/
+  	pthread_mutex_t rowsLock;
+  	int ingestActive; //set while a reader thread is still adding rows
+  	
+  	/*
+  		the ui sleeps in epoll until something happens, a key on stdin, a resize from the
+  		signalfd, the status message running out on the timerfd, or a background thread
+  		writing to wakeFd because it wants a redraw
+  	*/
+  	int epollFd;
+  	int signalFd;
+  	int timerFd;
+  	int wakeFd;
+  	int inotifyFd; //tells us when the file is changed by something else
+  	int watchFd;
+  	
+  	UndoRecord* undo;
+  	int undoCount;
+  	int undoCapacity;
+  	int undoGroup;
+  	int undoKind; //what the last group was, typing on the same row carries on with it
+  	int undoRow;
+  	
+  	/*
+  		the row tree adds up the rows bracket summaries so the matching bracket can be found
+  		without reading every row in between, nodes are linked by index like the word nodes
+  		and freed nodes are linked through left so they can be used again
+  	*/
+  	RowNode* rowNodes;
+  	int rowNodeCount;
+  	int rowNodeCapacity;
+  	int rowNodeFree;
+  	int rowRoot;
+  	int bracketLine[2]; //the bracket under the cursor and its match, line is -1 when there is none
+  	int bracketCol[2];
+  	
+  	/*
+  		yScroll and cy count visible lines, so once rows are folded they no longer match the
+  		row numbers, the row tree counts the rows that arent hidden so a visible line can be
+  		turned into a row and back without walking the hidden rows
+  	*/
+  	int hiddenRows; //when no rows are hidden the tree isnt needed at all
+  	
+  	/*
+  		when long lines are wrapped the row tree adds up the screen lines the shown rows take up,
+  		so a screen line can be turned into a row and back in log n, a row that is changed only
+  		updates its own weight
+  		wrapTreeDirty is set when every row's weight changes, turning wrapping on or the filter
+  		changing, then they are all worked out again before the tree is next read
+  		wrapTop is the screen line at the top, it can be part way down a row, and yScroll and
+  		cy are kept as the visible lines so nothing else has to know about wrapping
+  	*/
+  	int wrapActive;
+  	int wrapTreeDirty;
+  	int wrapWidth; //the width the rows lines were worked out for, a resize works them out again
+  	int wrapTop;
+  	int wrapYScroll; //yScroll when wrapTop was last worked out, if it moved something else scrolled
+  	int wrapCursorX; //where the cursor is on screen with wrapping
+  	int wrapCursorY;
+  	
+  	/*
+  		while a filter is on only the rows in filterRows are shown, in order, and they take
+  		over from the folds as the visible lines
+  	*/
+  	int filterActive;
+  	char* filterQuery;
+  	int* filterRows;
+  	int filterCount;
+  	int filterCapacity;
+  	
+  	//what the file on disk looked like when it was last opened or saved
+  	SyncBlock* diskBlocks;
+  	int diskBlockCount;
+  	off_t diskSize;
+  	struct timespec diskMtime;
+  	int diskConflict; //set once a save was warned that the file changed on disk
+  	
+  	/*
+  		the hex view draws straight out of a private mapping of the file, only the lines on
+  		screen are ever read, bytes typed over only change the mapping and hexDirty marks
+  		the pages they are in, those pages are written to the file when it is saved
+  	*/
+  	int hexActive;
+  	int hexOnly; //the file has nul bytes so it wasnt read into rows at all
+  	unsigned char* hexData;
+  	size_t hexSize;
+  	int hexFd; //kept open to see if the file got smaller under the mapping
+  	int hexWritable;
+  	int hexChanged; //typed over bytes were saved, so the rows need reading in again after
+  	unsigned char* hexDirty; //a bit for each page
+  	HexEdit* hexUndo;
+  	int hexUndoCount;
+  	int hexUndoCapacity;
+  	int hexSavedUndo; //hexUndoCount when the bytes were last saved, -1 once undo has gone past it and new bytes were typed
+  	size_t hexTop; //the offset of the first line on screen
+  	size_t hexCursor; //the byte the cursor is on
+  	int hexNibble; //0 for the high half of the byte, 1 for the low half
+  	size_t hexFindStart;
+  	
+  	/*
+  		the fuzzy finder keeps only its best few matches, fuzzyQuery is the query they are for
+  		and is NULL when scoring was cut short by another key so the next key scores again
+  		fuzzyGeneration goes up to tell the scoring threads their query is old and to stop
+  	*/
+  	int fuzzyActive;
+  	FuzzyMatch fuzzyResults[FUZZY_TOP_K];
+  	int fuzzyCount;
+  	int fuzzyMatched; //how many rows matched at all
+  	int fuzzySelected;
+  	char* fuzzyQuery;
+  	int fuzzyGeneration;
+  	
+  	/*
+  		a directory search streams its results into the rows, searchQuery is set while the
+  		rows are results so enter opens one instead of splitting the line
+  		searchGeneration goes up to stop a search that is still going from adding any more
+  	*/
+  	char* searchQuery;
+  	int searchActive;
+  	int searchGeneration;
+  	
+  	/*
+  		the word index has every word in the rows before wordNext, a background thread moves
+  		wordNext along and changed rows before it are put in again, all under the rows lock
+  		the completion is the list of words ctrl-n goes round
+  	*/
+  	WordNode* wordNodes;
+  	int wordNodeCount;
+  	int wordNodeCapacity;
+  	int wordRoot;
+  	int wordFree; //nodes of words that arent used any more, linked through eq
+  	int wordNext;
+  	long long wordTotal;
+  	long long charTotal;
+  	pthread_cond_t wordReady; //there are rows past wordNext
+  	char* completeWords[WORD_COMPLETE_MAX];
+  	int completeCount;
+  	int completeIndex;
+  	int completeLine;
+  	int completeStart; //where the typed part of the word starts
+  	int completeLength; //how long the typed part is
+  	int completeEnd; //where the cursor was left after the last completion
+  	
+  	/*
+  		with --server scripts send commands down a unix socket, they are run on the ui thread
+  		between keys so they can use the same edits as typing does
+  		promptActive holds them back while a prompt is open
+  	*/
+  	int serverFd;
+  	char* serverPath;
+  	ServerClient serverClients[SERVER_MAX_CLIENTS];
+  	int promptActive;
+  	
+  	/*
+  		the selection runs from the anchor to the cursor, the anchor is a raw position so it
+  		stays on the same charicter when the cursor moves sideways
+  		the clipboard is one slice for each line that was copied, the bytes are only gathered
+  		up when they are sent to the terminal or written out
+  	*/
+  	int selectActive;
+  	int selectRow;
+  	int selectRaw;
+  	TextSlice* clipLines;
+  	int clipCount;
 };
 
 struct EditorConfig E;
@@ -77,22 +533,138 @@ enum editorKey {
     ARROW_RIGHT,
     CTRL_ARROW_LEFT,
     CTRL_ARROW_RIGHT,
+    SHIFT_ARROW_UP,
+    SHIFT_ARROW_DOWN,
+    SHIFT_ARROW_LEFT,
+    SHIFT_ARROW_RIGHT,
     PAGE_UP,
     PAGE_DOWN,
     DELETE_KEY,
-    END
+    END,
+    REDRAW_KEY //not a real key, returned when a background thread wants the screen redrawn
+};
+
+//how the file on disk is compressed, found from its magic bytes when it is opened
+enum editorCompression {
+	COMPRESSION_NONE = 0,
+	COMPRESSION_GZIP,
+	COMPRESSION_ZSTD
+};
+
+enum editorUndoType {
+	UNDO_ROW_CHANGED = 0,
+	UNDO_ROW_INSERTED,
+	UNDO_ROW_DELETED,
+	UNDO_ROWS_INSERTED,
+	UNDO_ROWS_DELETED
+};
+
+enum editorUndoKind {
+	UNDO_EDIT = 0,
+	UNDO_TYPING,
+	UNDO_DELETING
 };
 
 enum editorHighlight {
   HL_NORMAL = 0,
   HL_NUMBER,
-  HL_MATCH
+  HL_MATCH,
+  HL_BRACKET,
+  HL_COMMENT,
+  HL_MLCOMMENT,
+  HL_KEYWORD1,
+  HL_KEYWORD2,
+  HL_STRING
 };
 
 /**** PROTOTYPES ****/
+struct abuf;
 void editorSetStatusMessage (const char* fmt, ...);
 void editorRefreshScreen ();
 char* editorPrompt (char* prompt, void (*callback)(char *, int));
+char* editorPromptAllowEmpty (char* prompt, void (*callback)(char *, int), int allowEmpty);
+void editorLockRows ();
+void editorUnlockRows ();
+int getWindowSize (int* rows, int* cols);
+int getCursorPositionInRenderdFileLine ();
+void editorSetCursorCol (int col);
+int editorRowRawToCol (EditorRow* row, int raw);
+int editorRowColToRaw (EditorRow* row, int col);
+RowChunk* editorLongRowChunkForRaw (EditorRow* row, int raw);
+RowIndexEntry editorLongRowPosFromRaw (EditorRow* row, int raw);
+RowIndexEntry editorLongRowPosFromCol (EditorRow* row, int col);
+void editorRowCloseGap (EditorRow* row);
+void editorRowOwnText (EditorRow* row);
+void editorRowDropText (EditorRow* row);
+void editorRowGiveText (EditorRow* row, char* text, int length);
+int editorRowCols (EditorRow* row);
+void editorUpdateRowSyntax (EditorRow* row);
+int editorHighlightText (const SyntaxLanguage* syntax, const char* text, unsigned char* hl, int length, int inComment);
+int editorGapRowEndsInComment (EditorRow* row, int start);
+int editorGapCommentByte (char c);
+char* editorMapFile (const char* path, size_t* size);
+void editorUnmapFile (char* text, size_t size);
+void editorUpdateRow (EditorRow* row);
+void editorIngestStart (int fd, int compression);
+int editorFindInText (const char* text, int length, const char* query, int queryLength);
+void editorUndoBegin (int kind, int row);
+void editorUndoSaveRow (int row);
+void editorUndoInsertedRow (int row);
+void editorUndoDeletedRow (int row);
+void editorBracketScan (BracketSummary* summary, const char* text, int length);
+void editorBracketCombine (BracketSummary* summary, const BracketSummary* next);
+void editorBracketRowChanged (EditorRow* row);
+void editorRowTreeChanged (EditorRow* row);
+int editorRowShownLines (int row);
+void editorFilterMark (int filtered);
+void editorRowTreeClean (int node, int lo);
+int editorRowTreeSize (int node);
+void editorRowTreeInsert (int at, int count);
+void editorRowTreeDelete (int at, int count);
+int editorVisibleToRow (int visible);
+int editorRowToVisible (int row);
+int editorVisibleCount ();
+void editorUnfold (int head);
+void editorUnfoldContaining (int row);
+void editorMakeRowVisible (int row);
+void editorFilterRowsInserted (int at, int count);
+void editorFilterRowsDeleted (int at, int count);
+void editorFilterRemoveRow (int row);
+void editorWrapRowChanged (EditorRow* row);
+void editorWordRowChanged (EditorRow* row);
+void editorWordRowAdded (int row);
+void editorWordRowDeleted (int row);
+int editorSelectionCols (int line, int* startCol, int* endCol);
+int editorSelectionKeepKey (int c);
+void editorMoveCursor (int key);
+void editorDiskEvent ();
+void editorServerEvent ();
+int editorServerPending ();
+void editorWatchFile ();
+void editorDiskRecord (SyncBlock* blocks, int count);
+int editorDiskChanged ();
+SyncBlock* editorSyncTextBlocks (const char* text, size_t size, int* count);
+SyncBlock* editorSyncRowBlocks (int* count);
+void editorReload ();
+int editorHexSniff (int fd);
+int editorHexOpen ();
+void editorHexScroll ();
+void editorHexDrawLine (struct abuf* buff, int y);
+void editorHexProcessKey (int c);
+void editorHexToggle ();
+void editorFuzzyDrawPopup (struct abuf* buff);
+void editorFilterClear ();
+void editorHexClose ();
+void editorHexCheckSize ();
+void editorCloseFile ();
+void editorOpenFd (char* filePath, int fd);
+void editorUndoClear ();
+void editorIngestLine (char* line, size_t length);
+void editorRequestRedraw ();
+int editorIndexCacheOpen (int fd);
+int editorIndexCacheWanted (int fd);
+void editorIndexPush (IndexBuilder* index, uint64_t offset);
+void editorIndexCacheWrite (int fd, IndexBuilder* index);
 
 /**** TERMINAL ****/
 
@@ -189,6 +761,7 @@ void enableRawMode () {
      * c_cc is an array of controle charicters for varius terminal settings
      * VMIN is the minumum number of bytes needed to read in
      * VTIME is how long to wait untill the next read in (is in tenths of a second)
+     * waiting for a key is done in epoll, so this only matters for the rest of an escape sequence
      */
     raw.c_cc[VMIN]  = 0;
     raw.c_cc[VTIME] = 1;
@@ -206,10 +779,140 @@ void dissableRawMode () {
     }
 }
 
+//what woke the ui up, more than one can be set at once
+enum editorEvent {
+	EVENT_KEY    = 1,
+	EVENT_RESIZE = 2,
+	EVENT_REDRAW = 4,
+	EVENT_DISK   = 8,
+	EVENT_SERVER = 16
+};
+
+void editorWatchFd (int fd) {
+	struct epoll_event ev;
+	
+	ev.events = EPOLLIN;
+	ev.data.fd = fd;
+	if (epoll_ctl(E.epollFd, EPOLL_CTL_ADD, fd, &ev) == -1) { die("epoll_ctl"); }
+}
+
+/*
+	SIGWINCH is blocked so it only comes through the signalfd, this has to happen before
+	any threads are made so they all have it blocked too
+*/
+void editorInitEvents () {
+	sigset_t mask;
+	
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGWINCH);
+	if (sigprocmask(SIG_BLOCK, &mask, NULL) == -1) { die("sigprocmask"); }
+	
+	E.epollFd  = epoll_create1(EPOLL_CLOEXEC);
+	E.signalFd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+	E.timerFd  = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	E.wakeFd   = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	E.inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	E.watchFd  = -1;
+	if (E.epollFd == -1 || E.signalFd == -1 || E.timerFd == -1 || E.wakeFd == -1 || E.inotifyFd == -1) { die("event fds"); }
+	
+	editorWatchFd(STDIN_FILENO);
+	editorWatchFd(E.signalFd);
+	editorWatchFd(E.timerFd);
+	editorWatchFd(E.wakeFd);
+	editorWatchFd(E.inotifyFd);
+}
+
+//wakes the ui up after seconds, used so the status message is cleared when it runs out
+void editorArmTimer (int seconds) {
+	struct itimerspec spec;
+	
+	memset(&spec, 0, sizeof(spec));
+	spec.it_value.tv_sec = seconds;
+	timerfd_settime(E.timerFd, 0, &spec, NULL);
+}
+
+//reads whatever is waiting on a nonblocking fd so epoll stops reporting it
+void editorDrainFd (int fd, size_t size) {
+	char buf[sizeof(struct signalfd_siginfo)];
+	
+	while (read(fd, buf, size) > 0) {}
+}
+
+//sleeps until there is a key, a resize or a redraw, the caller must not hold the rows lock
+int editorWaitForEvent () {
+	struct epoll_event events[8];
+	int found = 0;
+	int n, i;
+	
+	while (found == 0) {
+		n = epoll_wait(E.epollFd, events, 8, -1);
+		if (n == -1) {
+			if (errno == EINTR) { continue; }
+			die("epoll_wait");
+		}
+		
+		for (i = 0; i < n; i++) {
+			int fd = events[i].data.fd;
+			
+			if (fd == STDIN_FILENO) {
+				if (events[i].events & (EPOLLHUP | EPOLLERR)) { die("stdin closed"); }
+				found |= EVENT_KEY;
+			} else if (fd == E.signalFd) {
+				editorDrainFd(fd, sizeof(struct signalfd_siginfo));
+				found |= EVENT_RESIZE;
+			} else if (fd == E.inotifyFd) {
+				found |= EVENT_DISK; //read by editorDiskEvent once the rows are locked
+			} else if (fd == E.timerFd || fd == E.wakeFd) {
+				editorDrainFd(fd, sizeof(uint64_t));
+				found |= EVENT_REDRAW;
+			} else {
+				found |= EVENT_SERVER; //the server socket or one of its clients, read once the rows are locked
+			}
+		}
+	}
+	return found;
+}
+
+//picks up the new terminal size and keeps the cursor on screen
+void editorHandleResize () {
+	int rows, cols;
+	int lastRow;
+	
+	if (getWindowSize(&rows, &cols) == -1) { return; }
+	E.screenRows = rows;
+	E.screenCols = cols;
+	
+	lastRow = E.screenRows - 2; //the last row of text, above the status bar
+	if (lastRow < HEADER_SIZE) { lastRow = HEADER_SIZE; }
+	if (E.cy > lastRow) {
+		E.yScroll += E.cy - lastRow;
+		E.cy = lastRow;
+	}
+	editorSetCursorCol(getCursorPositionInRenderdFileLine());
+}
+
 int editorKeyRead () {
     int nread;
     char c;
-    while ((nread = read(STDIN_FILENO, &c, 1)) != 1) {
+    
+    //commands held back by a prompt have the data read already so epoll wont say so again
+    if (editorServerPending()) { return REDRAW_KEY; }
+    
+    //the rows are only given up while waiting so the stream reader can add to them
+    while (1) {
+    	int events;
+    	
+    	editorUnlockRows();
+    	events = editorWaitForEvent();
+    	editorLockRows();
+    	
+    	if (events & EVENT_RESIZE) { editorHandleResize(); }
+    	if (events & EVENT_DISK) { editorDiskEvent(); }
+    	if (events & EVENT_SERVER) { editorServerEvent(); } //everything sent is done before the one redraw
+    	if (!(events & EVENT_KEY)) { return REDRAW_KEY; }
+    	
+    	nread = read(STDIN_FILENO, &c, 1);
+    	if (nread == 1) { break; }
         if (nread == -1 && errno != EAGAIN) { die("read"); }; 
     }
     
@@ -238,7 +941,15 @@ int editorKeyRead () {
                 	if (read(STDIN_FILENO, &seq[3], 1) != 1) { return '\x1b'; }
                 	if (read(STDIN_FILENO, &seq[4], 1) != 1) { return '\x1b'; }
 
-		            switch (seq[4]) {   
+		            if (seq[3] == '2') { //shift held down, it selects as it moves
+		            	switch (seq[4]) {
+		            		case 'A': return SHIFT_ARROW_UP;
+		            		case 'B': return SHIFT_ARROW_DOWN;
+		            		case 'C': return SHIFT_ARROW_RIGHT;
+		            		case 'D': return SHIFT_ARROW_LEFT;
+		            	}
+		            }
+		            switch (seq[4]) {
 		                case 'C': return CTRL_ARROW_RIGHT;
 		            	case 'D': return CTRL_ARROW_LEFT;       		
 		            }
@@ -286,44 +997,46 @@ int getCursorPosition (int* row, int* col) {
 }
 
 int getCurrentLineInFile () {
-	return E.cy + E.yScroll - HEADER_SIZE;
+	return editorVisibleToRow(E.cy + E.yScroll - HEADER_SIZE);
 }
 
+//this is the column in the line, so it counts the columns scrolled off the left of the screen
 int getCursorPositionInRenderdFileLine () { 
-	return E.cx - LINE_START_SIZE;
+	return E.cx - LINE_START_SIZE + E.xScroll;
 }
 
-// this gets the poistion not in screen space but in the raw line in the file, so this will compensate for tabs ect
-int getCursorPositionInRawFileLine () { 
-	int i = 0;
-	int pos = getCursorPositionInRenderdFileLine();
-	int total = 0;
-	
-	EditorRow* row = &E.rows[getCurrentLineInFile()];
-	
-	while (total < pos && i < row->rawLength) {
-		total++;
-		if (row->rawChars[i] == '\t') { total += TAB_SIZE - 1; }
-		i++;
-	}
+//puts the cursor on a column of the current line, scrolling sideways if it would be off screen
+void editorSetCursorCol (int col) {
+	int textCols = E.screenCols - LINE_START_SIZE;
 	
-	return i;
+	if (col < 0) { col = 0; }
+	if (col < E.xScroll) { E.xScroll = col; }
+	if (col >= E.xScroll + textCols) { E.xScroll = col - textCols + 1; }
+	E.cx = col - E.xScroll + LINE_START_SIZE;
 }
 
-//takes an index in the raw file and coverts it to screen space
-int getScreenSpaceFromRawLinePosition (int line, int index) { 
-	int i = 0;
-	int total = 0;
+//moves the cursor to a line and column, the line is put in the middle of the screen if it is off it
+void editorGoToLine (int line, int col) {
+	int textRows = E.screenRows - HEADER_SIZE - 1;
+	int visible;
 	
-	EditorRow* row = &E.rows[line];
+	if (line < E.numberOfRows) { editorMakeRowVisible(line); }
+	visible = editorRowToVisible(line);
 	
-	while (i < row->rawLength && i < index) {
-		total = (row->rawChars[i] == '\t') ? total + TAB_SIZE : total + 1;
-		i++;
+	if (visible < E.yScroll || visible >= E.yScroll + textRows) {
+		E.yScroll = visible - textRows / 2;
+		if (E.yScroll < 0) { E.yScroll = 0; }
 	}
-	//total--;
-	 
-	return total + LINE_START_SIZE;
+	E.cy = visible - E.yScroll + HEADER_SIZE;
+	editorSetCursorCol(col);
+}
+
+// this gets the poistion not in screen space but in the raw line in the file, so this will compensate for tabs ect
+int getCursorPositionInRawFileLine () { 
+	int line = getCurrentLineInFile();
+	
+	if (line < 0 || line >= E.numberOfRows) { return 0; }
+	return editorRowColToRaw(&E.rows[line], getCursorPositionInRenderdFileLine());
 }
 
 /**** APPEND BUFFER ****/
@@ -352,521 +1065,6880 @@ void abufFree (struct abuf* buf) {
     free(buf->buffer);
 }
 
-/**** EDITOR OPPERATIOS ****/
+/**** UNICODE ****/
+/*
+	rows are utf-8, each charicter can be 1 to 4 bytes and 0 to 2 columns wide on screen
+	the widths for the basic multilingual plane are packed into a table 2 bits per code
+	point when the editor starts, anything above that is looked up in the range lists
+*/
 
-void editorFreeRow(EditorRow *row) {
-  free(row->chars);
-  free(row->rawChars);
-  free(row->hl);
-}
+typedef struct CodepointRange {
+	unsigned int first;
+	unsigned int last;
+} CodepointRange;
 
-void editorUpdateRowSyntax (EditorRow* row) {
-	int i;
-	
-	row->hl = realloc(row->hl, row->length);
-  	memset(row->hl, HL_NORMAL, row->length);
-  	
-  	for (i = 0; i < row->length; i++) {
-  		char c = row->chars[i];
-  	
-  		if (isdigit(c)) {
-  			row->hl[i] = HL_NUMBER;
-  		}	
-  	}
-} 
+//combining marks and other charicters that take up no columns
+const CodepointRange zeroWidthRanges[] = {
+	{0x0300, 0x036F}, {0x0483, 0x0489}, {0x0591, 0x05BD}, {0x05BF, 0x05BF},
+	{0x05C1, 0x05C2}, {0x05C4, 0x05C5}, {0x05C7, 0x05C7}, {0x0610, 0x061A},
+	{0x064B, 0x065F}, {0x0670, 0x0670}, {0x06D6, 0x06DC}, {0x06DF, 0x06E4},
+	{0x06E7, 0x06E8}, {0x06EA, 0x06ED}, {0x0711, 0x0711}, {0x0730, 0x074A},
+	{0x07A6, 0x07B0}, {0x0900, 0x0902}, {0x093C, 0x093C}, {0x0941, 0x0948},
+	{0x094D, 0x094D}, {0x0951, 0x0957}, {0x0962, 0x0963}, {0x0981, 0x0981},
+	{0x09BC, 0x09BC}, {0x09C1, 0x09C4}, {0x09CD, 0x09CD}, {0x0E31, 0x0E31},
+	{0x0E34, 0x0E3A}, {0x0E47, 0x0E4E}, {0x1AB0, 0x1AFF}, {0x1DC0, 0x1DFF},
+	{0x200B, 0x200F}, {0x202A, 0x202E}, {0x2060, 0x2064}, {0x20D0, 0x20FF},
+	{0xFE00, 0xFE0F}, {0xFE20, 0xFE2F}, {0xFEFF, 0xFEFF}, {0x1D167, 0x1D169},
+	{0xE0001, 0xE007F}, {0xE0100, 0xE01EF}
+};
 
-int editorSyntaxToColor(int hl) {
- 	switch (hl) {
-		case HL_NUMBER: return 31;
-		case HL_MATCH:  return 34;
+//east asian wide and full width charicters and emoji, these take up two columns
+const CodepointRange wideRanges[] = {
+	{0x1100, 0x115F}, {0x231A, 0x231B}, {0x2329, 0x232A}, {0x23E9, 0x23EC},
+	{0x23F0, 0x23F0}, {0x23F3, 0x23F3}, {0x25FD, 0x25FE}, {0x2614, 0x2615},
+	{0x2648, 0x2653}, {0x267F, 0x267F}, {0x2693, 0x2693}, {0x26A1, 0x26A1},
+	{0x26AA, 0x26AB}, {0x26BD, 0x26BE}, {0x26C4, 0x26C5}, {0x26CE, 0x26CE},
+	{0x26D4, 0x26D4}, {0x26EA, 0x26EA}, {0x26F2, 0x26F3}, {0x26F5, 0x26F5},
+	{0x26FA, 0x26FA}, {0x26FD, 0x26FD}, {0x2705, 0x2705}, {0x270A, 0x270B},
+	{0x2728, 0x2728}, {0x274C, 0x274C}, {0x274E, 0x274E}, {0x2753, 0x2755},
+	{0x2757, 0x2757}, {0x2795, 0x2797}, {0x27B0, 0x27B0}, {0x27BF, 0x27BF},
+	{0x2B1B, 0x2B1C}, {0x2B50, 0x2B50}, {0x2B55, 0x2B55}, {0x2E80, 0x303E},
+	{0x3041, 0x33FF}, {0x3400, 0x4DBF}, {0x4E00, 0x9FFF}, {0xA000, 0xA4CF},
+	{0xA960, 0xA97F}, {0xAC00, 0xD7A3}, {0xF900, 0xFAFF}, {0xFE10, 0xFE19},
+	{0xFE30, 0xFE6F}, {0xFF00, 0xFF60}, {0xFFE0, 0xFFE6}, {0x16FE0, 0x16FE4},
+	{0x17000, 0x18AFF}, {0x1B000, 0x1B2FF}, {0x1F004, 0x1F004}, {0x1F0CF, 0x1F0CF},
+	{0x1F18E, 0x1F18E}, {0x1F191, 0x1F19A}, {0x1F200, 0x1F202}, {0x1F210, 0x1F23B},
+	{0x1F240, 0x1F248}, {0x1F250, 0x1F251}, {0x1F300, 0x1F64F}, {0x1F680, 0x1F6FF},
+	{0x1F7E0, 0x1F7EB}, {0x1F90C, 0x1F9FF}, {0x1FA70, 0x1FAFF}, {0x20000, 0x2FFFD},
+	{0x30000, 0x3FFFD}
+};
+
+#define WIDTH_ZERO 1
+#define WIDTH_WIDE 2
+
+unsigned char bmpWidths[0x10000 / 4]; //2 bits per code point, 0 means one column
+
+void editorFillWidthTable (const CodepointRange* ranges, int count, unsigned char width) {
+	int i;
+	unsigned int cp;
 	
-		default: return 37;
+	for (i = 0; i < count; i++) {
+		for (cp = ranges[i].first; cp <= ranges[i].last && cp < 0x10000; cp++) {
+			bmpWidths[cp >> 2] |= width << ((cp & 3) * 2);
+		}
 	}
 }
 
-void editorUpdateRow (EditorRow* row) { //used to update the lines that are actually being maniputalted and rendered on screen
-	int j;
-	int idx  = 0;
-	int tabs = 0;
+void editorBuildWidthTable () {
+	memset(bmpWidths, 0, sizeof(bmpWidths));
+	editorFillWidthTable(zeroWidthRanges, sizeof(zeroWidthRanges) / sizeof(CodepointRange), WIDTH_ZERO);
+	editorFillWidthTable(wideRanges, sizeof(wideRanges) / sizeof(CodepointRange), WIDTH_WIDE);
+}
 
- 	for (j = 0; j < row->rawLength; j++) {
-    	if (row->rawChars[j] == '\t') tabs++;
+int codepointInRanges (unsigned int cp, const CodepointRange* ranges, int count) {
+	int low = 0;
+	int high = count - 1;
+	
+	while (low <= high) {
+		int mid = (low + high) / 2;
+		if (cp < ranges[mid].first) { high = mid - 1; }
+		else if (cp > ranges[mid].last) { low = mid + 1; }
+		else { return 1; }
 	}
+	return 0;
+}
 
-	free(row->chars);
-	row->chars = malloc(row->rawLength + tabs*(TAB_SIZE -1) + 1); //1 is subtracted from tab size as row length allready includes that 1!
+//how many columns a code point takes up on screen
+int codepointWidth (unsigned int cp) {
+	if (cp < 0x10000) {
+		int width = (bmpWidths[cp >> 2] >> ((cp & 3) * 2)) & 3;
+		return (width == WIDTH_ZERO) ? 0 : (width == WIDTH_WIDE) ? 2 : 1;
+	}
+	if (codepointInRanges(cp, zeroWidthRanges, sizeof(zeroWidthRanges) / sizeof(CodepointRange))) { return 0; }
+	if (codepointInRanges(cp, wideRanges, sizeof(wideRanges) / sizeof(CodepointRange))) { return 2; }
+	return 1;
+}
 
-	for (j = 0; j < row->rawLength; j++) {
-		if (row->rawChars[j] == '\t') {
-		    row->chars[idx++] = ' ';
-      		while (idx % 8 != 0) row->chars[idx++] = ' ';
-		} else { 
-			row->chars[idx++] = row->rawChars[j];
-		}
+/*
+	reads the utf-8 charicter at s, returns how many bytes it is or 0 if it is not valid
+	utf-8 (overlong, surrogate or cut off), those bytes get shown as a '?'
+*/
+int utf8Decode (const char* str, int length, unsigned int* cp) {
+	const unsigned char* s = (const unsigned char*)str;
+	int needed;
+	int i;
+	
+	if (s[0] < 0x80) {
+		*cp = s[0];
+		return 1;
+	} else if (s[0] >= 0xC2 && s[0] <= 0xDF) {
+		needed = 1;
+		*cp = s[0] & 0x1F;
+	} else if (s[0] >= 0xE0 && s[0] <= 0xEF) {
+		needed = 2;
+		*cp = s[0] & 0x0F;
+	} else if (s[0] >= 0xF0 && s[0] <= 0xF4) {
+		needed = 3;
+		*cp = s[0] & 0x07;
+	} else {
+		return 0;
 	}
 	
-	row->chars[idx] = '\0';
-	row->length = idx;
+	if (needed >= length) { return 0; }
+	for (i = 1; i <= needed; i++) {
+		if ((s[i] & 0xC0) != 0x80) { return 0; }
+		*cp = (*cp << 6) | (s[i] & 0x3F);
+	}
 	
-	editorUpdateRowSyntax(row);
+	if (needed == 2 && (*cp < 0x800 || (*cp >= 0xD800 && *cp <= 0xDFFF))) { return 0; }
+	if (needed == 3 && (*cp < 0x10000 || *cp > 0x10FFFF)) { return 0; }
+	
+	return needed + 1;
 }
 
-void editorInsertRow (int at, char* str, size_t length) {
-	if (at < 0 || at > E.numberOfRows) { return; }
-
-	E.rows = realloc(E.rows, sizeof(EditorRow) * (E.numberOfRows + 1));
-	memmove(&E.rows[at + 1], &E.rows[at], sizeof(EditorRow) * (E.numberOfRows - at));
-
-	E.rows = realloc(E.rows, sizeof(EditorRow) * (E.numberOfRows + 1));
+/*
+	works out the charicter at the start of text, how many raw and rendered bytes it is
+	and how many columns it takes up when it starts at column col
+*/
+void editorTextCharAt (const char* text, int length, int col, int* rawBytes, int* renderBytes, int* width) {
+	unsigned int cp;
+	int n;
 	
-	E.rows[at].rawLength = length;
-	E.rows[at].rawChars = malloc(length + 1);
-	memcpy(E.rows[at].rawChars, str, length);
-	E.rows[at].chars = '\0';
+	if (text[0] == '\t') {
+		*rawBytes = 1;
+		*width = TAB_SIZE - (col % TAB_SIZE);
+		*renderBytes = *width;
+		return;
+	}
 	
-	E.rows[at].length = 0;
-	E.rows[at].chars = NULL;
+	n = utf8Decode(text, length, &cp);
+	if (n == 0) { //broken utf-8 is shown as one '?'
+		*rawBytes = 1;
+		*renderBytes = 1;
+		*width = 1;
+		return;
+	}
 	
-	E.rows[at].hl = NULL;
+	*rawBytes = n;
+	*renderBytes = n;
+	*width = (n == 1) ? 1 : codepointWidth(cp);
+}
+
+/*
+	gives a pointer to the raw byte at raw and how many bytes come after it before the end
+	of the row, the end of a chunk or the gap
+*/
+const char* editorRowText (EditorRow* row, int raw, int* length) {
+	if (row->longRow) {
+		RowChunk* chunk = editorLongRowChunkForRaw(row, raw);
+		int offset = raw - chunk->startRaw;
+		
+		*length = chunk->length - offset;
+		return &chunk->data[offset];
+	}
 	
-	editorUpdateRow(&E.rows[at]);
-	 
-	E.numberOfRows++;
+	if (row->hasGap && raw >= row->gapStart) {
+		*length = row->rawLength - raw;
+		return &row->rawChars[raw + row->gapLength];
+	}
+	*length = (row->hasGap ? row->gapStart : row->rawLength) - raw;
+	return &row->rawChars[raw];
+}
 
-    debugOutput(E.rows[at].chars);
-    debugOutput(E.rows[at].rawChars);
+void editorRowCharAt (EditorRow* row, RowIndexEntry* pos, int* rawBytes, int* renderBytes, int* width) {
+	int length;
+	const char* text = editorRowText(row, pos->raw, &length);
+	
+	editorTextCharAt(text, length, pos->col, rawBytes, renderBytes, width);
 }
 
-void editorInsertNewLine () {
-	int line = getCurrentLineInFile();
-	int at = getCursorPositionInRenderdFileLine(); //where the break in the line is 
-	if (at == 0) {
-		editorInsertRow(line, "", 0);
+//writes how a charicter looks on screen, tabs become spaces and broken utf-8 a '?'
+void editorRenderChar (char* dest, const char* text, int rawBytes, int renderBytes) {
+	if (text[0] == '\t') {
+		memset(dest, ' ', renderBytes);
+	} else if (rawBytes == 1 && (unsigned char)text[0] >= 0x80) {
+		dest[0] = '?';
 	} else {
-	  EditorRow *row = &E.rows[line];
-	  editorInsertRow(line + 1, &row->rawChars[at], row->rawLength - at);
-	  
-	  row = &E.rows[line];
-	  row->rawLength = row->rawLength - (row->rawLength - at);
-	  row->rawChars[row->rawLength] = '\0';
-	  editorUpdateRow(row);
+		memcpy(dest, text, renderBytes);
 	}
-
-	E.cy++;
-	E.cx = LINE_START_SIZE;
 }
 
-void editorRowAppendString (EditorRow* row, char* str, size_t length) {
-
-  row->rawChars = realloc(row->rawChars, row->rawLength + length + 1);
-  memcpy(&row->rawChars[row->rawLength], str, length);
-  row->rawLength += length;
-  row->rawChars[row->rawLength] = '\0';
-  E.fileModified++;
-  editorUpdateRow(row);
+//moves pos on to the next charicter in the row
+void editorRowStep (EditorRow* row, RowIndexEntry* pos) {
+	int rawBytes, renderBytes, width;
+	
+	editorRowCharAt(row, pos, &rawBytes, &renderBytes, &width);
+	pos->raw    += rawBytes;
+	pos->render += renderBytes;
+	pos->col    += width;
 }
 
-void editorDelRow(int rowIndex) {
-	if (rowIndex < 0 || rowIndex >= E.numberOfRows) { return; }
+//gives the closest checkpoint at or before the raw position
+RowIndexEntry editorRowCheckpointForRaw (EditorRow* row, int raw) {
+	RowIndexEntry start = {0, 0, 0};
+	int k;
 	
-	editorFreeRow(&E.rows[rowIndex]);
-	memmove(&E.rows[rowIndex], &E.rows[rowIndex + 1], sizeof(EditorRow) * (E.numberOfRows - rowIndex - 1));
-	E.numberOfRows--;
-	//E.rows = realloc(E.rows, E.numberOfRows );
+	if (row->index == NULL || row->indexLength == 0) { return start; }
+	k = raw / ROW_INDEX_STEP;
+	if (k > row->indexLength - 1) { k = row->indexLength - 1; }
+	if (k > 0 && row->index[k].raw > raw) { k--; } //the checkpoint got pushed past raw by a multi byte charicter
+	if (row->index[k].raw > raw) { return start; }
+	return row->index[k];
 }
 
-/*
-	"row" is a referance to the row that is being changed
-	"at" is where the char is to be inserted
-	"c" is the charictor to be insterted
-*/
-void editorRowInsertChar (EditorRow* row, int at, int c) {
-	if (at < 0 || at > row->rawLength) { at = row->rawLength; }
-	  
-	row->rawChars = realloc(row->rawChars, row->rawLength + 2);
-	memmove(&row->rawChars[at + 1], &row->rawChars[at], row->rawLength - at + 1);
-	row->rawChars[at] = c;
-	row->rawLength++;
+//gives the closest checkpoint at or before the column, this is a binary search over the checkpoints
+RowIndexEntry editorRowCheckpointForCol (EditorRow* row, int col) {
+	RowIndexEntry start = {0, 0, 0};
+	int low = 0;
+	int high;
 	
-	editorUpdateRow(row);
+	if (row->index == NULL || row->indexLength == 0) { return start; }
+	high = row->indexLength - 1;
+	
+	while (low < high) {
+		int mid = (low + high + 1) / 2;
+		if (row->index[mid].col <= col) { low = mid; }
+		else { high = mid - 1; }
+	}
+	return row->index[low];
 }
 
-void editorInsertChar (char c) {
-	int line = getCurrentLineInFile();
-	if (line == E.numberOfRows) {
-		editorInsertRow(E.numberOfRows ,"", 0);
-	} 
-	else if (line > E.numberOfRows) { return; }
-	else if (line < 0) { return; } 
+//finds the start of the charicter that covers the raw position
+RowIndexEntry editorRowPosFromRaw (EditorRow* row, int raw) {
+	if (row->longRow) { return editorLongRowPosFromRaw(row, raw); }
 	
-	editorRowInsertChar(&E.rows[line], getCursorPositionInRawFileLine(), c);
-	E.cx++;
-	E.fileModified++;
+	RowIndexEntry pos = editorRowCheckpointForRaw(row, raw);
+	
+	while (pos.raw < row->rawLength) {
+		RowIndexEntry next = pos;
+		editorRowStep(row, &next);
+		if (next.raw > raw) { break; }
+		pos = next;
+	}
+	return pos;
 }
 
-void editorRowDelChar(EditorRow* row, int at) {
-	if (at < 0 || at >= row->length) { return; }
+//finds the start of the charicter that covers the column, or the end of the row
+RowIndexEntry editorRowPosFromCol (EditorRow* row, int col) {
+	if (row->longRow) { return editorLongRowPosFromCol(row, col); }
 	
-	at = getCursorPositionInRawFileLine();
-	memmove(&row->rawChars[at], &row->rawChars[at + 1], row->rawLength - at);
-	row->rawLength--;
-	row->rawChars = realloc(row->rawChars, row->rawLength);
+	RowIndexEntry pos = editorRowCheckpointForCol(row, col);
 	
-	editorUpdateRow(row);
+	while (pos.raw < row->rawLength) {
+		RowIndexEntry next = pos;
+		editorRowStep(row, &next);
+		if (next.col > col) { break; }
+		pos = next;
+	}
+	return pos;
 }
 
-void editorDeleteChar () {
-	int line = getCurrentLineInFile();
-	if (line >= E.numberOfRows || line < 0) {
-		return;
-	} 
-	else if (getCursorPositionInRenderdFileLine() < 0) {
-	    int newCx = E.rows[E.cy - 1 - HEADER_SIZE].length + LINE_START_SIZE - 1;
-	    
-    	editorRowAppendString(&E.rows[line - 1], E.rows[line].chars, E.rows[line].length);
-    	editorDelRow(E.cy - HEADER_SIZE);
-    	E.cy--;
-    	E.cx = newCx;
+int editorRowRawToCol (EditorRow* row, int raw) {
+	return editorRowPosFromRaw(row, raw).col;
+}
+
+int editorRowColToRaw (EditorRow* row, int col) {
+	return editorRowPosFromCol(row, col).raw;
+}
+
+int editorRowRawToRender (EditorRow* row, int raw) {
+	return editorRowPosFromRaw(row, raw).render;
+}
+
+//how many columns the charicter at the column is, 1 past the end of the row
+int editorRowCharWidthAtCol (EditorRow* row, int col) {
+	RowIndexEntry pos = editorRowPosFromCol(row, col);
+	RowIndexEntry next = pos;
+	
+	if (pos.raw >= row->rawLength) { return 1; }
+	editorRowStep(row, &next);
+	return next.col - pos.col;
+}
+
+/**** LONG ROWS ****/
+/*
+	minified json and log blobs can be tens of MB on one line, rows like that are kept in
+	chunks so an edit only moves the bytes in one chunk, and only the columns that are on
+	screen get rendered and highlighted
+*/
+
+int editorLongRowChunkIndexForRaw (LongRow* longRow, int raw) {
+	int low = 0;
+	int high = longRow->count - 1;
+	
+	while (low < high) {
+		int mid = (low + high + 1) / 2;
+		if (longRow->chunks[mid].startRaw <= raw) { low = mid; }
+		else { high = mid - 1; }
+	}
+	return low;
+}
+
+int editorLongRowChunkIndexForCol (LongRow* longRow, int col) {
+	int low = 0;
+	int high = longRow->count - 1;
+	
+	while (low < high) {
+		int mid = (low + high + 1) / 2;
+		if (longRow->chunks[mid].startCol <= col) { low = mid; }
+		else { high = mid - 1; }
+	}
+	return low;
+}
+
+RowChunk* editorLongRowChunkForRaw (EditorRow* row, int raw) {
+	return &row->longRow->chunks[editorLongRowChunkIndexForRaw(row->longRow, raw)];
+}
+
+RowIndexEntry editorLongRowPosFromRaw (EditorRow* row, int raw) {
+	RowChunk* chunk = editorLongRowChunkForRaw(row, raw);
+	RowIndexEntry pos = {chunk->startRaw, 0, chunk->startCol};
+	int offset = 0;
+	
+	while (offset < chunk->length) {
+		int rawBytes, renderBytes, width;
+		
+		editorTextCharAt(&chunk->data[offset], chunk->length - offset, pos.col, &rawBytes, &renderBytes, &width);
+		if (pos.raw + rawBytes > raw) { break; }
+		pos.raw += rawBytes;
+		pos.col += width;
+		offset  += rawBytes;
+	}
+	return pos;
+}
+
+RowIndexEntry editorLongRowPosFromCol (EditorRow* row, int col) {
+	RowChunk* chunk = &row->longRow->chunks[editorLongRowChunkIndexForCol(row->longRow, col)];
+	RowIndexEntry pos = {chunk->startRaw, 0, chunk->startCol};
+	int offset = 0;
+	
+	while (offset < chunk->length) {
+		int rawBytes, renderBytes, width;
+		
+		editorTextCharAt(&chunk->data[offset], chunk->length - offset, pos.col, &rawBytes, &renderBytes, &width);
+		if (pos.col + width > col) { break; }
+		pos.raw += rawBytes;
+		pos.col += width;
+		offset  += rawBytes;
+	}
+	return pos;
+}
+
+//works out the widths of a chunk for every column it could start on in one pass
+void editorChunkMeasure (RowChunk* chunk) {
+	int cols[TAB_SIZE];
+	int offset = 0;
+	int m;
+	
+	for (m = 0; m < TAB_SIZE; m++) { cols[m] = m; }
+	
+	while (offset < chunk->length) {
+		int rawBytes, renderBytes, width;
+		
+		editorTextCharAt(&chunk->data[offset], chunk->length - offset, 0, &rawBytes, &renderBytes, &width);
+		for (m = 0; m < TAB_SIZE; m++) {
+			cols[m] += (chunk->data[offset] == '\t') ? TAB_SIZE - (cols[m] % TAB_SIZE) : width;
+		}
+		offset += rawBytes;
+	}
+	
+	for (m = 0; m < TAB_SIZE; m++) { chunk->widths[m] = cols[m] - m; }
+	
+	memset(&chunk->brackets, 0, sizeof(BracketSummary));
+	editorBracketScan(&chunk->brackets, chunk->data, chunk->length);
+	chunk->dirty = 0;
+}
+
+/*
+	measures the chunks that were edited and adds up where every chunk starts, this only
+	walks the text of the dirty chunks, the rest is adding up the widths
+*/
+void editorLongRowUpdate (EditorRow* row) {
+	LongRow* longRow = row->longRow;
+	int raw = 0;
+	int col = 0;
+	int k;
+	
+	memset(&row->brackets, 0, sizeof(BracketSummary));
+	for (k = 0; k < longRow->count; k++) {
+		RowChunk* chunk = &longRow->chunks[k];
+		
+		if (chunk->dirty) { editorChunkMeasure(chunk); }
+		chunk->startRaw = raw;
+		chunk->startCol = col;
+		raw += chunk->length;
+		col += chunk->widths[col % TAB_SIZE];
+		editorBracketCombine(&row->brackets, &chunk->brackets);
+	}
+	
+	row->rawLength = raw;
+	row->cols = col;
+}
+
+//makes room for count empty chunks starting at index at
+RowChunk* editorLongRowAddChunks (LongRow* longRow, int at, int count) {
+	int k;
+	
+	if (longRow->count + count > longRow->capacity) {
+		longRow->capacity = (longRow->count + count) * 2;
+		longRow->chunks = realloc(longRow->chunks, sizeof(RowChunk) * longRow->capacity);
+		if (longRow->chunks == NULL) { die("realloc"); }
+	}
+	memmove(&longRow->chunks[at + count], &longRow->chunks[at], sizeof(RowChunk) * (longRow->count - at));
+	longRow->count += count;
+	
+	for (k = at; k < at + count; k++) {
+		memset(&longRow->chunks[k], 0, sizeof(RowChunk));
+		longRow->chunks[k].data = malloc(LONG_ROW_CHUNK * 2);
+		if (longRow->chunks[k].data == NULL) { die("malloc"); }
+		longRow->chunks[k].dirty = 1;
+	}
+	return &longRow->chunks[at];
+}
+
+//moves offset back to the start of a charicter so a chunk never ends half way through one
+int editorChunkSplitPoint (const char* data, int offset) {
+	while (offset > 0 && (data[offset] & 0xC0) == 0x80) { offset--; }
+	return offset;
+}
+
+//puts text into chunks starting at index at, each one is filled to LONG_ROW_CHUNK
+void editorLongRowFillChunks (LongRow* longRow, int at, const char* text, int length) {
+	int pieces = 0;
+	int offset = 0;
+	
+	while (offset < length) {
+		int end = (length - offset > LONG_ROW_CHUNK) ? editorChunkSplitPoint(text, offset + LONG_ROW_CHUNK) : length;
+		if (end <= offset) { end = offset + LONG_ROW_CHUNK; }
+		offset = end;
+		pieces++;
+	}
+	
+	editorLongRowAddChunks(longRow, at, pieces);
+	offset = 0;
+	while (offset < length) {
+		RowChunk* chunk = &longRow->chunks[at++];
+		int end = (length - offset > LONG_ROW_CHUNK) ? editorChunkSplitPoint(text, offset + LONG_ROW_CHUNK) : length;
+		if (end <= offset) { end = offset + LONG_ROW_CHUNK; }
+		
+		memcpy(chunk->data, &text[offset], end - offset);
+		chunk->length = end - offset;
+		offset = end;
+	}
+}
+
+void editorLongRowInsert (EditorRow* row, int at, const char* str, int length) {
+	LongRow* longRow;
+	RowChunk* chunk;
+	int k, offset;
+	
+	editorRowOwnText(row); //a shared row gets its own chunks before they change
+	longRow = row->longRow;
+	k = editorLongRowChunkIndexForRaw(longRow, at);
+	chunk = &longRow->chunks[k];
+	offset = at - chunk->startRaw;
+	
+	if (chunk->length + length <= LONG_ROW_CHUNK * 2) { //the normal case, only this chunk moves
+		memmove(&chunk->data[offset + length], &chunk->data[offset], chunk->length - offset);
+		memcpy(&chunk->data[offset], str, length);
+		chunk->length += length;
+		chunk->dirty = 1;
+	} else {
+		//the chunk is full so it is cut at "at" and the new text goes in as chunks between the two halves
+		int tailLength = chunk->length - offset;
+		char* tail = malloc(tailLength + 1);
+		
+		memcpy(tail, &chunk->data[offset], tailLength);
+		chunk->length = offset;
+		chunk->dirty = 1;
+		
+		editorLongRowFillChunks(longRow, k + 1, tail, tailLength);
+		editorLongRowFillChunks(longRow, k + 1, str, length);
+		free(tail);
+	}
+	row->rawLength += length;
+}
+
+void editorLongRowDelete (EditorRow* row, int at, int length) {
+	LongRow* longRow;
+	int k, offset;
+	int remaining = length;
+	int kept = 0;
+	int j;
+	
+	editorRowOwnText(row);
+	longRow = row->longRow;
+	k = editorLongRowChunkIndexForRaw(longRow, at);
+	offset = at - longRow->chunks[k].startRaw;
+	
+	while (remaining > 0 && k < longRow->count) {
+		RowChunk* chunk = &longRow->chunks[k];
+		int n = chunk->length - offset;
+		
+		if (n > remaining) { n = remaining; }
+		memmove(&chunk->data[offset], &chunk->data[offset + n], chunk->length - offset - n);
+		chunk->length -= n;
+		chunk->dirty = 1;
+		remaining -= n;
+		offset = 0;
+		k++;
+	}
+	
+	//emptied chunks are dropped in one pass, the row always keeps at least one
+	for (j = 0; j < longRow->count; j++) {
+		if (longRow->chunks[j].length == 0) {
+			free(longRow->chunks[j].data);
+			continue;
+		}
+		longRow->chunks[kept++] = longRow->chunks[j];
+	}
+	longRow->count = kept;
+	if (kept == 0) { editorLongRowAddChunks(longRow, 0, 1); }
+	row->rawLength -= length - remaining;
+}
+
+void editorRowMakeLong (EditorRow* row) {
+	LongRow* longRow = calloc(1, sizeof(LongRow));
+	
+	if (longRow == NULL) { die("calloc"); }
+	editorLongRowFillChunks(longRow, 0, row->rawChars, row->rawLength);
+	if (longRow->count == 0) { editorLongRowAddChunks(longRow, 0, 1); }
+	
+	editorRowDropText(row);
+	free(row->index);
+	row->rawChars = NULL;
+	row->index = NULL;
+	row->longRow = longRow;
+}
+
+void editorLongRowFree (LongRow* longRow) {
+	int k;
+	
+	for (k = 0; k < longRow->count; k++) { free(longRow->chunks[k].data); }
+	free(longRow->chunks);
+	free(longRow);
+}
+
+//a copy of every chunk, for a shared long row that is about to be changed
+LongRow* editorLongRowCopy (LongRow* longRow) {
+	LongRow* copy = malloc(sizeof(LongRow));
+	int k;
+	
+	if (copy == NULL) { die("malloc"); }
+	*copy = *longRow;
+	copy->chunks = malloc(sizeof(RowChunk) * longRow->capacity);
+	if (copy->chunks == NULL) { die("malloc"); }
+	
+	for (k = 0; k < longRow->count; k++) {
+		copy->chunks[k] = longRow->chunks[k];
+		copy->chunks[k].data = malloc(LONG_ROW_CHUNK * 2);
+		if (copy->chunks[k].data == NULL) { die("malloc"); }
+		memcpy(copy->chunks[k].data, longRow->chunks[k].data, longRow->chunks[k].length);
+	}
+	return copy;
+}
+
+//gathers part of the text of a long row out of its chunks
+void editorLongRowCopyText (LongRow* longRow, int start, int length, char* dest) {
+	int k = editorLongRowChunkIndexForRaw(longRow, start);
+	
+	while (length > 0 && k < longRow->count) {
+		RowChunk* chunk = &longRow->chunks[k++];
+		int offset = start - chunk->startRaw;
+		int n = chunk->length - offset;
+		
+		if (n > length) { n = length; }
+		memcpy(dest, &chunk->data[offset], n);
+		dest   += n;
+		start  += n;
+		length -= n;
+	}
+}
+
+//copies part of the raw text of any row into dest, long rows are gathered from their chunks
+void editorRowCopy (EditorRow* row, int start, int length, char* dest) {
+	if (row->hasGap) { //the bytes before the gap then the bytes after it
+		int before = row->gapStart - start;
+		
+		if (before > length) { before = length; }
+		if (before > 0) {
+			memcpy(dest, &row->rawChars[start], before);
+			dest   += before;
+			start  += before;
+			length -= before;
+		}
+		memcpy(dest, &row->rawChars[start + row->gapLength], length);
+		return;
+	}
+	
+	if (!row->longRow) {
+		memcpy(dest, &row->rawChars[start], length);
+		return;
+	}
+	editorLongRowCopyText(row->longRow, start, length, dest);
+}
+
+void editorRowMakeShort (EditorRow* row) {
+	char* raw = malloc(row->rawLength + 1);
+	
+	if (raw == NULL) { die("malloc"); }
+	editorRowCopy(row, 0, row->rawLength, raw);
+	raw[row->rawLength] = '\0';
+	
+	editorRowDropText(row);
+	row->longRow = NULL;
+	row->rawChars = raw;
+}
+
+char editorRowByteAt (EditorRow* row, int at) {
+	char c;
+	
+	editorRowCopy(row, at, 1, &c);
+	return c;
+}
+
+//finds query in the raw text of a row, returns where it starts or -1
+int editorRowFind (EditorRow* row, const char* query) {
+	int queryLength = strlen(query);
+	char* boundary;
+	int k;
+	
+	if (row->hasGap) { editorRowCloseGap(row); }
+	
+	if (!row->longRow) { return editorFindInText(row->rawChars, row->rawLength, query, queryLength); }
+	if (queryLength == 0) { return 0; }
+	
+	boundary = malloc(queryLength * 2);
+	for (k = 0; k < row->longRow->count; k++) {
+		RowChunk* chunk = &row->longRow->chunks[k];
+		int match = editorFindInText(chunk->data, chunk->length, query, queryLength);
+		int chunkEnd = chunk->startRaw + chunk->length;
+		int start, length;
+		
+		if (match != -1) {
+			free(boundary);
+			return chunk->startRaw + match;
+		}
+		
+		//a match could start in this chunk and finish in the next one
+		start = chunkEnd - (queryLength - 1);
+		if (start < chunk->startRaw) { start = chunk->startRaw; }
+		length = (queryLength - 1) * 2;
+		if (start + length > row->rawLength) { length = row->rawLength - start; }
+		if (length >= queryLength) {
+			editorRowCopy(row, start, length, boundary);
+			match = editorFindInText(boundary, length, query, queryLength);
+			if (match != -1) {
+				start += match;
+				free(boundary);
+				return start;
+			}
+		}
+	}
+	free(boundary);
+	return -1;
+}
+
+/**** GAP BUFFER ****/
+/*
+	the row being typed in gets a gap at the cursor, typing fills the gap and deleting
+	grows it so nothing after the cursor has to move, the gap only moves when the cursor
+	does, when the cursor leaves the row the gap is closed and the row rendered as normal
+	while it has a gap the row is rendered like a long row, only the part on screen
+*/
+
+//the checkpoints after an edit at "at" are wrong now, the ones before it are still right
+void editorGapDropIndex (EditorRow* row, int at) {
+	while (row->indexLength > 0 && row->index[row->indexLength - 1].raw > at) {
+		row->indexLength--;
+	}
+}
+
+void editorGapOpen (EditorRow* row) {
+	//only one row has a gap at a time
+	if (E.gapRow != -1 && &E.rows[E.gapRow] != row) { editorRowCloseGap(&E.rows[E.gapRow]); }
+	
+	editorRowOwnText(row); //the gap is made in the row's own copy, never in shared text
+	row->rawChars = realloc(row->rawChars, row->rawLength + GAP_SIZE);
+	if (row->rawChars == NULL) { die("realloc"); }
+	row->hasGap = 1;
+	row->gapStart = row->rawLength;
+	row->gapLength = GAP_SIZE;
+	row->gapCommentFrom = -1;
+	E.gapRow = row - E.rows;
+}
+
+void editorGapMove (EditorRow* row, int at) {
+	if (at < row->gapStart) {
+		memmove(&row->rawChars[at + row->gapLength], &row->rawChars[at], row->gapStart - at);
+	} else if (at > row->gapStart) {
+		memmove(&row->rawChars[row->gapStart], &row->rawChars[row->gapStart + row->gapLength], at - row->gapStart);
+	}
+	row->gapStart = at;
+}
+
+void editorGapGrow (EditorRow* row) {
+	int size = row->rawLength + row->gapLength;
+	int added = (size < GAP_SIZE) ? GAP_SIZE : size;
+	int after = row->rawLength - row->gapStart;
+	
+	row->rawChars = realloc(row->rawChars, size + added);
+	if (row->rawChars == NULL) { die("realloc"); }
+	memmove(&row->rawChars[row->gapStart + row->gapLength + added], &row->rawChars[row->gapStart + row->gapLength], after);
+	row->gapLength += added;
+}
+
+void editorGapInsert (EditorRow* row, int at, char c) {
+	if (!row->hasGap) { editorGapOpen(row); }
+	if (row->gapLength == 0) { editorGapGrow(row); }
+	
+	editorGapMove(row, at);
+	if (editorGapCommentByte(c)) { row->gapCommentFrom = -1; }
+	row->rawChars[row->gapStart++] = c;
+	row->gapLength--;
+	row->rawLength++;
+	editorGapDropIndex(row, at);
+}
+
+void editorGapDelete (EditorRow* row, int at, int length) {
+	int i;
+	
+	if (!row->hasGap) { editorGapOpen(row); }
+	
+	editorGapMove(row, at);
+	//the deleted bytes sit just after the gap
+	for (i = 0; i < length; i++) {
+		if (editorGapCommentByte(row->rawChars[row->gapStart + row->gapLength + i])) { row->gapCommentFrom = -1; }
+	}
+	row->gapLength += length;
+	row->rawLength -= length;
+	editorGapDropIndex(row, at);
+}
+
+//takes the gap out of the row and renders it as a normal row again
+void editorRowCloseGap (EditorRow* row) {
+	if (!row->hasGap) { return; }
+	
+	memmove(&row->rawChars[row->gapStart], &row->rawChars[row->gapStart + row->gapLength], row->rawLength - row->gapStart);
+	row->rawChars = realloc(row->rawChars, row->rawLength + 1);
+	row->rawChars[row->rawLength] = '\0';
+	row->hasGap = 0;
+	row->gapLength = 0;
+	if (E.gapRow == row - E.rows) { E.gapRow = -1; }
+	
+	editorUpdateRow(row);
+}
+
+//closes the gap once the cursor has moved off the row that has it
+void editorSyncGapRow () {
+	if (E.gapRow != -1 && E.gapRow != getCurrentLineInFile()) {
+		editorRowCloseGap(&E.rows[E.gapRow]);
+	}
+}
+
+//the row being typed in works out its width when something asks for it
+int editorRowCols (EditorRow* row) {
+	if (row->cols < 0) { row->cols = editorRowPosFromRaw(row, row->rawLength).col; }
+	return row->cols;
+}
+
+/*
+	renders only the columns from startCol that fit in cols into chars and hl, so drawing
+	a long row or the row being typed in costs the width of the screen not the whole row
+*/
+void editorRowRenderWindow (EditorRow* row, int startCol, int cols) {
+	RowIndexEntry pos = editorRowPosFromCol(row, startCol);
+	int render = 0;
+	
+	row->chars = realloc(row->chars, (cols + TAB_SIZE) * 4 + 1);
+	row->windowCol = pos.col;
+	
+	while (pos.col < startCol + cols && pos.raw < row->rawLength) {
+		int length, rawBytes, renderBytes, width;
+		const char* text = editorRowText(row, pos.raw, &length);
+		
+		editorTextCharAt(text, length, pos.col, &rawBytes, &renderBytes, &width);
+		editorRenderChar(&row->chars[render], text, rawBytes, renderBytes);
+		render  += renderBytes;
+		pos.raw += rawBytes;
+		pos.col += width;
+	}
+	
+	row->chars[render] = '\0';
+	row->length = render;
+	editorUpdateRowSyntax(row);
+}
+
+/**** SHARED TEXT ****/
+/*
+	copying text into the clipboard or undo takes a referance to the rows text rather than
+	copying the bytes, everything that changes a rows text calls editorRowOwnText first so
+	the row gets its own copy and the shared one is left as it was
+*/
+
+//shares the text of a row and returns it with a referance taken for the caller
+SharedText* editorRowShare (EditorRow* row) {
+	if (row->hasGap) { editorRowCloseGap(row); } //the text has to be in one piece to be shared
+	
+	if (row->shared == NULL) {
+		row->shared = malloc(sizeof(SharedText));
+		if (row->shared == NULL) { die("malloc"); }
+		row->shared->refs = 1;
+		row->shared->rawChars = row->rawChars;
+		row->shared->rawLength = row->rawLength;
+		row->shared->longRow = row->longRow;
+	}
+	row->shared->refs++;
+	return row->shared;
+}
+
+void editorTextRelease (SharedText* text) {
+	if (--text->refs > 0) { return; }
+	
+	free(text->rawChars);
+	if (text->longRow) { editorLongRowFree(text->longRow); }
+	free(text);
+}
+
+//frees the text of a row, or only lets go of it if something else still has it
+void editorRowDropText (EditorRow* row) {
+	if (row->shared) {
+		editorTextRelease(row->shared);
+		row->shared = NULL;
+	} else {
+		free(row->rawChars);
+		if (row->longRow) { editorLongRowFree(row->longRow); }
+	}
+	row->rawChars = NULL;
+	row->longRow = NULL;
+}
+
+//the row is about to change its text, so if it is shared it gets a copy of its own
+void editorRowOwnText (EditorRow* row) {
+	SharedText* text = row->shared;
+	
+	if (text == NULL) { return; }
+	row->shared = NULL;
+	if (text->refs == 1) { //nothing else has it any more, so the row can just keep it
+		free(text);
+		return;
+	}
+	
+	if (row->longRow) {
+		row->longRow = editorLongRowCopy(row->longRow);
+	} else {
+		row->rawChars = malloc(row->rawLength + 1);
+		if (row->rawChars == NULL) { die("malloc"); }
+		memcpy(row->rawChars, text->rawChars, row->rawLength);
+		row->rawChars[row->rawLength] = '\0';
+	}
+	text->refs--;
+}
+
+//gives a row that has no text yet some shared text, it is updated after
+void editorRowUseText (EditorRow* row, SharedText* text) {
+	text->refs++;
+	row->shared = text;
+	row->rawChars = text->rawChars;
+	row->rawLength = text->rawLength;
+	row->longRow = text->longRow;
+}
+
+//copies the bytes of a slice into dest
+void editorSliceCopy (TextSlice* slice, char* dest) {
+	if (slice->text->longRow) {
+		editorLongRowCopyText(slice->text->longRow, slice->start, slice->length, dest);
+	} else {
+		memcpy(dest, &slice->text->rawChars[slice->start], slice->length);
+	}
+}
+
+void editorSlicesFree (TextSlice* slices, int count) {
+	int i;
+	
+	for (i = 0; i < count; i++) { editorTextRelease(slices[i].text); }
+	free(slices);
+}
+
+/**** SYNTAX ****/
+
+//this has to be the same as syntaxHash in syntaxgen.c
+unsigned int syntaxHash (unsigned int seed, const char* word, int length) {
+	unsigned int h = 2166136261u ^ (seed * 0x9e3779b1u);
+	int i;
+	
+	for (i = 0; i < length; i++) {
+		h ^= (unsigned char)word[i];
+		h *= 16777619u;
+	}
+	h ^= h >> 15;
+	return h;
+}
+
+//returns the highlight for a word that is a keyword, or HL_NORMAL
+int editorSyntaxKeyword (const SyntaxLanguage* syntax, const char* word, int length) {
+	unsigned int seed = syntax->displacements[syntaxHash(0, word, length) % syntax->bucketCount];
+	const SyntaxKeyword* keyword = &syntax->keywords[syntaxHash(seed, word, length) & syntax->keywordMask];
+	
+	if (keyword->length != length || memcmp(keyword->word, word, length) != 0) { return HL_NORMAL; }
+	return (keyword->kind == 1) ? HL_KEYWORD1 : HL_KEYWORD2;
+}
+
+//the language for a file, by its extension or by its whole name for things like Makefile
+const SyntaxLanguage* editorSelectSyntax (const char* path) {
+	const char* name = strrchr(path, '/');
+	const char* extension;
+	int i, j;
+	
+	name = name ? name + 1 : path;
+	extension = strrchr(name, '.');
+	
+	for (i = 0; i < SYNTAX_LANGUAGE_COUNT; i++) {
+		for (j = 0; syntaxLanguages[i].extensions[j]; j++) {
+			const char* match = syntaxLanguages[i].extensions[j];
+			
+			if (match[0] == '.' ? (extension && strcmp(extension, match) == 0) : strcmp(name, match) == 0) {
+				return &syntaxLanguages[i];
+			}
+		}
+	}
+	return NULL;
+}
+
+/*
+	fills hl for text, inComment is whether it starts inside a block comment and the return
+	is whether it ends in one, every byte is looked up in the class table once so there is one
+	branch on what kind of byte it is instead of a compare for every kind
+*/
+int editorHighlightText (const SyntaxLanguage* syntax, const char* text, unsigned char* hl, int length, int inComment) {
+	const unsigned char* classes = syntax->classes;
+	int lineCommentLength  = syntax->lineComment ? strlen(syntax->lineComment) : 0;
+	int blockStartLength   = syntax->blockStart ? strlen(syntax->blockStart) : 0;
+	int blockEndLength     = syntax->blockEnd ? strlen(syntax->blockEnd) : 0;
+	int afterSeparator = 1;
+	char quote = 0;
+	int i = 0;
+	
+	while (i < length) {
+		unsigned char c = text[i];
+		int class = classes[c];
+		
+		if (inComment) {
+			if (c == syntax->blockEnd[0] && i + blockEndLength <= length && memcmp(&text[i], syntax->blockEnd, blockEndLength) == 0) {
+				memset(&hl[i], HL_MLCOMMENT, blockEndLength);
+				i += blockEndLength;
+				inComment = 0;
+				afterSeparator = 1;
+			} else {
+				hl[i++] = HL_MLCOMMENT;
+			}
+			continue;
+		}
+		
+		if (quote) {
+			hl[i] = HL_STRING;
+			if (c == '\\' && i + 1 < length) {
+				hl[++i] = HL_STRING;
+			} else if (c == quote) {
+				quote = 0;
+			}
+			i++;
+			afterSeparator = 1;
+			continue;
+		}
+		
+		if (class & SYNTAX_COMMENT) {
+			if (lineCommentLength && i + lineCommentLength <= length && memcmp(&text[i], syntax->lineComment, lineCommentLength) == 0) {
+				memset(&hl[i], HL_COMMENT, length - i);
+				return 0;
+			}
+			if (blockStartLength && i + blockStartLength <= length && memcmp(&text[i], syntax->blockStart, blockStartLength) == 0) {
+				memset(&hl[i], HL_MLCOMMENT, blockStartLength);
+				i += blockStartLength;
+				inComment = 1;
+				continue;
+			}
+		}
+		
+		if (class & SYNTAX_QUOTE) {
+			quote = c;
+			hl[i++] = HL_STRING;
+			continue;
+		}
+		
+		if (afterSeparator && (class & SYNTAX_DIGIT)) {
+			do { hl[i++] = HL_NUMBER; } while (i < length && (classes[(unsigned char)text[i]] & SYNTAX_NUMBER));
+			afterSeparator = 0;
+			continue;
+		}
+		
+		if (afterSeparator && (class & SYNTAX_WORD)) {
+			int start = i;
+			
+			while (i < length && (classes[(unsigned char)text[i]] & (SYNTAX_WORD | SYNTAX_DIGIT))) { i++; }
+			memset(&hl[start], editorSyntaxKeyword(syntax, &text[start], i - start), i - start);
+			afterSeparator = 0;
+			continue;
+		}
+		
+		hl[i++] = HL_NORMAL;
+		afterSeparator = class & SYNTAX_SEPARATOR;
+	}
+	return inComment;
+}
+
+//picks the language from the file name and highlights every row again
+void editorSyntaxFromPath () {
+	int i;
+	
+	E.syntax = E.filePath ? editorSelectSyntax(E.filePath) : NULL;
+	if (E.gapRow != -1) { E.rows[E.gapRow].gapCommentFrom = -1; } //a new language reads the row differently
+	for (i = 0; i < E.numberOfRows; i++) { editorUpdateRowSyntax(&E.rows[i]); }
+}
+
+/*
+	make bench runs this, it highlights a file line by line over and over for a second
+	and prints how many MB a second the lexer got through
+*/
+void editorSyntaxBenchmark (const char* path) {
+	const SyntaxLanguage* syntax = editorSelectSyntax(path);
+	struct timespec start, now;
+	unsigned char* hl;
+	double seconds = 0;
+	int passes = 0;
+	size_t size;
+	char* text;
+	
+	if (syntax == NULL) {
+		fprintf(stderr, "no language for %s\n", path);
+		exit(1);
+	}
+	if ((text = editorMapFile(path, &size)) == NULL || size == 0) {
+		fprintf(stderr, "could not read %s\n", path);
+		exit(1);
+	}
+	if ((hl = malloc(size)) == NULL) { die("malloc"); }
+	
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	while (seconds < 1.0) {
+		size_t pos = 0;
+		int inComment = 0;
+		
+		while (pos < size) {
+			const char* newLine = memchr(&text[pos], '\n', size - pos);
+			size_t end = newLine ? (size_t)(newLine - text) : size;
+			
+			inComment = editorHighlightText(syntax, &text[pos], &hl[pos], end - pos, inComment);
+			pos = end + 1;
+		}
+		passes++;
+		
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		seconds = (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) / 1e9;
+	}
+	
+	printf("%s (%s): %.1f MB/s, %d passes of %zu bytes\n", path, syntax->name, (double)size * passes / seconds / 1e6, passes, size);
+	free(hl);
+	editorUnmapFile(text, size);
+}
+
+/**** EDITOR OPPERATIOS ****/
+
+void editorFreeRow(EditorRow *row) {
+  free(row->chars);
+  editorRowDropText(row);
+  free(row->hl);
+  free(row->index);
+  free(row->wordIds);
+}
+
+//whether the row with the gap ends in a block comment, its window might not reach the end so the raw text is read
+int editorGapRowEndsInComment (EditorRow* row, int start) {
+	if (row->gapCommentFrom == start) { return row->hlOpenComment; } //no comment or string byte has changed since
+
+	char* text = malloc(row->rawLength + 1);
+	unsigned char* hl = malloc(row->rawLength + 1);
+	int open;
+	
+	if (text == NULL || hl == NULL) { die("malloc"); }
+	editorRowCopy(row, 0, row->rawLength, text);
+	open = editorHighlightText(E.syntax, text, hl, row->rawLength, start);
+	free(text);
+	free(hl);
+	row->gapCommentFrom = start;
+	return open;
+}
+
+//whether typing or deleting c can change if a row ends in a block comment, only comment, string and escape bytes can
+int editorGapCommentByte (char c) {
+	const SyntaxLanguage* syntax = E.syntax;
+	
+	if (syntax == NULL || c == '\0') { return 0; }
+	if (c == '\\' || (syntax->classes[(unsigned char)c] & SYNTAX_QUOTE)) { return 1; }
+	if (syntax->lineComment && strchr(syntax->lineComment, c)) { return 1; }
+	if (syntax->blockStart && strchr(syntax->blockStart, c)) { return 1; }
+	return syntax->blockEnd && strchr(syntax->blockEnd, c);
+}
+
+/*
+	highlights a row, a row that now ends in a different comment state than before changes
+	how the rows after it start, so they are done again until one ends the same as it did
+	long rows are only rendered a window at a time and are too big to read through, so they keep
+	what they had till they are rendered whole again
+*/
+void editorUpdateRowSyntax (EditorRow* row) {
+	int at = row - E.rows;
+	
+	while (1) {
+		int start = (at > 0) ? E.rows[at - 1].hlOpenComment : 0;
+		int open;
+		int i;
+		
+		row->hl = realloc(row->hl, row->length + 1); //+1 so an empty row still gets a buffer
+		if (E.syntax == NULL) {
+			memset(row->hl, HL_NORMAL, row->length);
+			for (i = 0; i < row->length; i++) {
+				if (isdigit(row->chars[i])) { row->hl[i] = HL_NUMBER; }
+			}
+			return;
+		}
+		
+		open = editorHighlightText(E.syntax, row->chars, row->hl, row->length, start);
+		if (row->hasGap && !row->longRow) { open = editorGapRowEndsInComment(row, start); }
+		if (row->longRow || open == row->hlOpenComment) { return; }
+		
+		row->hlOpenComment = open;
+		if (++at >= E.numberOfRows) { return; }
+		row = &E.rows[at];
+	}
+}
+
+int editorSyntaxToColor(int hl) {
+ 	switch (hl) {
+		case HL_NUMBER: return 31;
+		case HL_MATCH:  return 34;
+		case HL_BRACKET: return 35;
+		case HL_COMMENT:
+		case HL_MLCOMMENT: return 36;
+		case HL_KEYWORD1: return 33;
+		case HL_KEYWORD2: return 32;
+		case HL_STRING: return 95;
+	
+		default: return 37;
+	}
+}
+
+void editorUpdateRow (EditorRow* row) { //used to update the lines that are actually being maniputalted and rendered on screen
+	int j;
+	int tabs = 0;
+	int checkpoint = 0;
+	RowIndexEntry pos = {0, 0, 0};
+	
+	if (row->hasGap) { //the row being typed in is rendered when it is drawn
+		//its brackets and words are counted again when the gap is closed, matching reads this row's text itself
+		row->cols = -1;
+		editorWrapRowChanged(row);
+		return;
+	}
+	
+	//rows switch to chunks when they get too long, and back again once they have shrunk
+	if (!row->longRow && row->rawLength > LONG_ROW_THRESHOLD) {
+		editorRowMakeLong(row);
+	} else if (row->longRow && row->rawLength < LONG_ROW_THRESHOLD / 2) {
+		editorRowMakeShort(row);
+	}
+	
+	if (row->longRow) { //the on screen part gets rendered when it is drawn
+		editorLongRowUpdate(row);
+		editorBracketRowChanged(row);
+		editorWrapRowChanged(row);
+		editorWordRowChanged(row);
+		return;
+	}
+
+ 	for (j = 0; j < row->rawLength; j++) {
+    	if (row->rawChars[j] == '\t') tabs++;
+	}
+
+	free(row->chars);
+	row->chars = malloc(row->rawLength + tabs*(TAB_SIZE -1) + 1); //1 is subtracted from tab size as row length allready includes that 1!
+	
+	free(row->index);
+	row->index = NULL;
+	if (row->rawLength >= ROW_INDEX_STEP) {
+		row->index = malloc(sizeof(RowIndexEntry) * (row->rawLength / ROW_INDEX_STEP + 1));
+	}
+
+	while (pos.raw < row->rawLength) {
+		int rawBytes, renderBytes, width;
+		
+		//a checkpoint is the first charicter start at or after each step
+		while (row->index && checkpoint * ROW_INDEX_STEP <= pos.raw) {
+			row->index[checkpoint++] = pos;
+		}
+		
+		editorRowCharAt(row, &pos, &rawBytes, &renderBytes, &width);
+		editorRenderChar(&row->chars[pos.render], &row->rawChars[pos.raw], rawBytes, renderBytes);
+		
+		pos.raw    += rawBytes;
+		pos.render += renderBytes;
+		pos.col    += width;
+	}
+	while (row->index && checkpoint <= row->rawLength / ROW_INDEX_STEP) {
+		row->index[checkpoint++] = pos;
+	}
+	row->indexLength = checkpoint;
+	
+	row->chars[pos.render] = '\0';
+	row->length = pos.render;
+	row->cols = pos.col;
+	
+	editorUpdateRowSyntax(row);
+	
+	memset(&row->brackets, 0, sizeof(BracketSummary));
+	editorBracketScan(&row->brackets, row->rawChars, row->rawLength);
+	editorBracketRowChanged(row);
+	editorWrapRowChanged(row);
+	editorWordRowChanged(row);
+}
+
+/*
+	makes room for count rows at "at" with one move of the rows after them, the new rows have
+	no text yet, the caller gives each one its text and then updates it
+*/
+void editorInsertRows (int at, int count) {
+	int i;
+	
+	//a row put between a fold and the rows it hides would break it, so the fold is opened
+	if (at < E.numberOfRows && E.rows[at].hidden) { editorUnfoldContaining(at); }
+
+	//rows grow by doubling so streaming in millions of lines doesnt realloc on every one
+	if (E.numberOfRows + count > E.rowsCapacity) {
+		E.rowsCapacity = (E.rowsCapacity == 0) ? 64 : E.rowsCapacity * 2;
+		if (E.rowsCapacity < E.numberOfRows + count) { E.rowsCapacity = E.numberOfRows + count; }
+		E.rows = realloc(E.rows, sizeof(EditorRow) * E.rowsCapacity);
+		if (E.rows == NULL) { die("realloc"); }
+	}
+	memmove(&E.rows[at + count], &E.rows[at], sizeof(EditorRow) * (E.numberOfRows - at));
+	editorRowTreeInsert(at, count); //before the filter is told so the rows have their nodes
+	
+	for (i = at; i < at + count; i++) {
+		E.rows[i].rawLength = 0;
+		E.rows[i].rawChars = NULL;
+		E.rows[i].shared = NULL;
+		
+		E.rows[i].length = 0;
+		E.rows[i].chars = NULL;
+		
+		E.rows[i].hl = NULL;
+		E.rows[i].index = NULL;
+		E.rows[i].longRow = NULL;
+		E.rows[i].windowCol = 0;
+		E.rows[i].hasGap = 0;
+		E.rows[i].gapStart = 0;
+		E.rows[i].gapLength = 0;
+		E.rows[i].indexLength = 0;
+		E.rows[i].gapCommentFrom = -1;
+		memset(&E.rows[i].brackets, 0, sizeof(BracketSummary));
+		E.rows[i].hidden = 0;
+		E.rows[i].foldedRows = 0;
+		E.rows[i].wrapLines = 1;
+		E.rows[i].filtered = 0;
+		E.rows[i].wordIds = NULL;
+		E.rows[i].wordIdCount = 0;
+		E.rows[i].wordTotal = 0;
+		E.rows[i].charTotal = 0;
+		//the row after this one started where the row before left off, so that is where this ends till it is highlighted
+		E.rows[i].hlOpenComment = (at > 0) ? E.rows[at - 1].hlOpenComment : 0;
+		editorWordRowAdded(i);
+	}
+	editorFilterRowsInserted(at, count);
+	if (E.gapRow >= at) { E.gapRow += count; }
+	
+	E.numberOfRows += count;
+}
+
+void editorInsertRow (int at, char* str, size_t length) {
+	char* text;
+	
+	if (at < 0 || at > E.numberOfRows) { return; }
+	
+	text = malloc(length + 1);
+	if (text == NULL) { die("malloc"); }
+	memcpy(text, str, length);
+	
+	editorInsertRows(at, 1);
+	editorRowGiveText(&E.rows[at], text, length);
+}
+
+void editorInsertNewLine () {
+	int line = getCurrentLineInFile();
+	int at = getCursorPositionInRawFileLine(); //where the break in the line is 
+	
+	if (line < 0 || line > E.numberOfRows) { return; }
+	editorUndoBegin(UNDO_EDIT, line);
+	if (at == 0) {
+		editorInsertRow(line, "", 0);
+		editorUndoInsertedRow(line);
+	} else {
+	  EditorRow *row = &E.rows[line];
+	  int tailLength = row->rawLength - at;
+	  char* tail = malloc(tailLength + 1);
+	  
+	  editorUndoSaveRow(line);
+	  editorRowCopy(row, at, tailLength, tail);
+	  editorInsertRow(line + 1, tail, tailLength);
+	  editorUndoInsertedRow(line + 1);
+	  free(tail);
+	  
+	  row = &E.rows[line];
+	  if (row->hasGap) { editorRowCloseGap(row); }
+	  editorRowOwnText(row);
+	  if (row->longRow) {
+	  	editorLongRowDelete(row, at, tailLength);
+	  } else {
+	  	row->rawLength = at;
+	  	row->rawChars[row->rawLength] = '\0';
+	  }
+	  editorUpdateRow(row);
+	}
+
+	E.cy++;
+	editorSetCursorCol(0);
+}
+
+void editorRowAppendString (EditorRow* row, char* str, size_t length) {
+  if (row->hasGap) { editorRowCloseGap(row); }
+  editorRowOwnText(row);
+  if (row->longRow) {
+  	editorLongRowInsert(row, row->rawLength, str, length);
+  	E.fileModified++;
+  	editorUpdateRow(row);
+  	return;
+  }
+
+  row->rawChars = realloc(row->rawChars, row->rawLength + length + 1);
+  memcpy(&row->rawChars[row->rawLength], str, length);
+  row->rawLength += length;
+  row->rawChars[row->rawLength] = '\0';
+  E.fileModified++;
+  editorUpdateRow(row);
+}
+
+//deletes count rows from rowIndex on with one move of the rows after them
+void editorDelRows (int rowIndex, int count) {
+	int open;
+	int i;
+	
+	if (rowIndex < 0 || count <= 0 || rowIndex + count > E.numberOfRows) { return; }
+	
+	if (E.gapRow >= rowIndex && E.gapRow < rowIndex + count) { E.gapRow = -1; }
+	else if (E.gapRow >= rowIndex + count) { E.gapRow -= count; }
+	
+	//from the last row back, so the rows still to go havent been moved by the ones before
+	for (i = rowIndex + count - 1; i >= rowIndex; i--) {
+		if (E.rows[i].hidden) { editorUnfoldContaining(i); }
+		if (E.rows[i].foldedRows) { editorUnfold(i); }
+		editorWordRowDeleted(i);
+	}
+	editorFilterRowsDeleted(rowIndex, count);
+	editorRowTreeDelete(rowIndex, count);
+	
+	open = E.rows[rowIndex + count - 1].hlOpenComment;
+	
+	for (i = rowIndex; i < rowIndex + count; i++) { editorFreeRow(&E.rows[i]); }
+	memmove(&E.rows[rowIndex], &E.rows[rowIndex + count], sizeof(EditorRow) * (E.numberOfRows - rowIndex - count));
+	E.numberOfRows -= count;
+	
+	//the next row now starts where the row before the deleted one ends
+	if (rowIndex < E.numberOfRows && open != (rowIndex > 0 ? E.rows[rowIndex - 1].hlOpenComment : 0)) {
+		editorUpdateRowSyntax(&E.rows[rowIndex]);
+	}
+	//E.rows = realloc(E.rows, E.numberOfRows );
+}
+
+void editorDelRow(int rowIndex) {
+	editorDelRows(rowIndex, 1);
+}
+
+//takes the raw text out of a row as one malloced string, the row has no text after this
+char* editorRowTakeText (EditorRow* row, int* length) {
+	char* text;
+	
+	if (row->hasGap) { editorRowCloseGap(row); }
+	if (row->longRow) {
+		text = malloc(row->rawLength + 1);
+		if (text == NULL) { die("malloc"); }
+		editorRowCopy(row, 0, row->rawLength, text);
+		text[row->rawLength] = '\0';
+		editorRowDropText(row);
+	} else {
+		editorRowOwnText(row);
+		text = row->rawChars;
+	}
+	
+	*length = row->rawLength;
+	row->rawChars = NULL;
+	row->rawLength = 0;
+	return text;
+}
+
+//gives a row new raw text that it then owns, text must have room for a '\0' on the end
+void editorRowGiveText (EditorRow* row, char* text, int length) {
+	editorRowDropText(row);
+	row->rawChars = text;
+	row->rawLength = length;
+	row->rawChars[length] = '\0';
+	editorUpdateRow(row);
+}
+
+/*
+	"row" is a referance to the row that is being changed
+	"at" is where the char is to be inserted
+	"c" is the charictor to be insterted
+*/
+void editorRowInsertChar (EditorRow* row, int at, int c) {
+	if (at < 0 || at > row->rawLength) { at = row->rawLength; }
+	
+	if (row->longRow) {
+		char ch = c;
+		editorLongRowInsert(row, at, &ch, 1);
+	} else {
+		editorGapInsert(row, at, c);
+	}
+	
+	editorUpdateRow(row);
+}
+
+void editorInsertChar (char c) {
+	int line = getCurrentLineInFile();
+	if (line > E.numberOfRows) { return; }
+	else if (line < 0) { return; } 
+	
+	editorUndoBegin(UNDO_TYPING, line);
+	if (line == E.numberOfRows) {
+		editorInsertRow(E.numberOfRows ,"", 0);
+		editorUndoInsertedRow(line);
+	} 
+	editorUndoSaveRow(line);
+	
+	int at = getCursorPositionInRawFileLine();
+	editorRowInsertChar(&E.rows[line], at, c);
+	editorSetCursorCol(editorRowRawToCol(&E.rows[line], at + 1));
+	E.fileModified++;
+}
+
+//deletes the whole charicter that starts at "at", a utf-8 charicter can be several bytes
+void editorRowDelChar(EditorRow* row, int at) {
+	RowIndexEntry pos;
+	int rawBytes, renderBytes, width;
+	
+	if (at < 0 || at >= row->rawLength) { return; }
+	
+	pos = editorRowPosFromRaw(row, at);
+	editorRowCharAt(row, &pos, &rawBytes, &renderBytes, &width);
+	if (row->longRow) {
+		editorLongRowDelete(row, pos.raw, rawBytes);
+	} else {
+		editorGapDelete(row, pos.raw, rawBytes);
+	}
+	
+	editorUpdateRow(row);
+}
+
+void editorDeleteChar () {
+	int line = getCurrentLineInFile();
+	if (line >= E.numberOfRows || line < 0) {
+		return;
+	} 
+	else if (getCursorPositionInRenderdFileLine() < 0) {
+		if (line == 0) {
+			editorSetCursorCol(0);
+			return;
+		}
+		
+	    //the row above is folded or filtered away, show it so the join happens where it can be seen
+	    if (editorVisibleToRow(editorRowToVisible(line) - 1) != line - 1) {
+	    	editorMakeRowVisible(line - 1);
+	    	editorGoToLine(line, 0);
+	    }
+	    
+	    int newCol = editorRowCols(&E.rows[line - 1]);
+	    EditorRow* row = &E.rows[line];
+	    char* text = malloc(row->rawLength + 1);
+	    
+	    editorUndoBegin(UNDO_EDIT, line - 1);
+	    editorUndoSaveRow(line - 1);
+	    editorUndoDeletedRow(line);
+	    
+	    editorRowCopy(row, 0, row->rawLength, text);
+    	editorRowAppendString(&E.rows[line - 1], text, row->rawLength);
+    	free(text);
+    	editorDelRow(line);
+    	E.cy--;
+    	editorSetCursorCol(newCol);
     	
     	
     } else {
-		editorRowDelChar(&E.rows[line], getCursorPositionInRawFileLine());
+    	int at = getCursorPositionInRawFileLine();
+    	
+    	if (at < E.rows[line].rawLength) {
+    		editorUndoBegin(UNDO_DELETING, line);
+    		editorUndoSaveRow(line);
+    	}
+		editorRowDelChar(&E.rows[line], at);
+		E.fileModified++;
+		editorSetCursorCol(editorRowRawToCol(&E.rows[line], at)); //the cursor stays where the deleted charicter started
+	}
+}
+
+/**** UNDO ****/
+
+UndoRecord* editorUndoPush (int type, int row) {
+	UndoRecord* rec;
+	
+	if (E.undoCount == E.undoCapacity) {
+		E.undoCapacity = (E.undoCapacity == 0) ? 64 : E.undoCapacity * 2;
+		E.undo = realloc(E.undo, sizeof(UndoRecord) * E.undoCapacity);
+		if (E.undo == NULL) { die("realloc"); }
+	}
+	
+	rec = &E.undo[E.undoCount++];
+	rec->group   = E.undoGroup;
+	rec->type    = type;
+	rec->row     = row;
+	rec->text    = NULL;
+	rec->length  = 0;
+	rec->cx      = E.cx;
+	rec->cy      = E.cy;
+	rec->xScroll = E.xScroll;
+	rec->yScroll = E.yScroll;
+	rec->count   = 1;
+	rec->slices  = NULL;
+	return rec;
+}
+
+//starts a new undo group, typing or deleting on the same row as last time carries on the last one
+void editorUndoBegin (int kind, int row) {
+	if (kind != UNDO_EDIT && kind == E.undoKind && row == E.undoRow && E.undoCount > 0) { return; }
+	
+	E.undoGroup++;
+	E.undoKind = kind;
+	E.undoRow  = row;
+}
+
+//keeps a copy of a row before it is changed, a row only needs saving once per group
+void editorUndoSaveRow (int row) {
+	UndoRecord* last = E.undoCount ? &E.undo[E.undoCount - 1] : NULL;
+	UndoRecord* rec;
+	EditorRow* r = &E.rows[row];
+	
+	if (last && last->group == E.undoGroup && last->type == UNDO_ROW_CHANGED && last->row == row) { return; }
+	
+	rec = editorUndoPush(UNDO_ROW_CHANGED, row);
+	rec->text = malloc(r->rawLength + 1);
+	if (rec->text == NULL) { die("malloc"); }
+	editorRowCopy(r, 0, r->rawLength, rec->text);
+	rec->length = r->rawLength;
+}
+
+//like editorUndoSaveRow but takes a string the caller has already got, the undo stack owns it after
+void editorUndoKeepRow (int row, char* text, int length) {
+	UndoRecord* rec = editorUndoPush(UNDO_ROW_CHANGED, row);
+	
+	rec->text   = text;
+	rec->length = length;
+}
+
+void editorUndoInsertedRow (int row) {
+	editorUndoPush(UNDO_ROW_INSERTED, row);
+}
+
+//must be called before the row is deleted so its text can be kept
+void editorUndoDeletedRow (int row) {
+	editorUndoSaveRow(row);
+	E.undo[E.undoCount - 1].type = UNDO_ROW_DELETED;
+}
+
+void editorUndoInsertedRows (int row, int count) {
+	editorUndoPush(UNDO_ROWS_INSERTED, row)->count = count;
+}
+
+//keeps the text of rows that are about to be deleted, it is shared with them so nothing is copied
+void editorUndoDeletedRows (int row, int count) {
+	UndoRecord* rec = editorUndoPush(UNDO_ROWS_DELETED, row);
+	int i;
+	
+	rec->count = count;
+	rec->slices = malloc(sizeof(TextSlice) * count);
+	if (rec->slices == NULL) { die("malloc"); }
+	for (i = 0; i < count; i++) {
+		rec->slices[i].text = editorRowShare(&E.rows[row + i]);
+		rec->slices[i].start = 0;
+		rec->slices[i].length = rec->slices[i].text->rawLength;
+	}
+}
+
+//forgets every undo, used when the whole file is read in again
+void editorUndoClear () {
+	int k;
+	
+	for (k = 0; k < E.undoCount; k++) {
+		free(E.undo[k].text);
+		if (E.undo[k].slices) { editorSlicesFree(E.undo[k].slices, E.undo[k].count); }
+	}
+	E.undoCount = 0;
+	E.undoKind = UNDO_EDIT;
+}
+
+//keeps the cursor on the text after rows have changed under it
+void editorClampCursor () {
+	int line = getCurrentLineInFile();
+	int col = getCursorPositionInRenderdFileLine();
+	EditorRow* row;
+	
+	if (line < 0 || line >= E.numberOfRows) { return; }
+	row = &E.rows[line];
+	if (col >= editorRowCols(row)) { col = editorRowCols(row); }
+	else if (col > 0) { col = editorRowPosFromCol(row, col).col; }
+	editorSetCursorCol(col);
+}
+
+//puts back everything in the last undo group, newest change first
+void editorUndo () {
+	int group;
+	UndoRecord* rec = NULL;
+	
+	if (E.undoCount == 0) {
+		editorSetStatusMessage("Nothing to undo");
+		return;
+	}
+	
+	group = E.undo[E.undoCount - 1].group;
+	while (E.undoCount > 0 && E.undo[E.undoCount - 1].group == group) {
+		int length;
+		int i;
+		
+		rec = &E.undo[--E.undoCount];
+		switch (rec->type) {
+			case UNDO_ROW_CHANGED:
+				if (rec->row < E.numberOfRows) {
+					free(editorRowTakeText(&E.rows[rec->row], &length));
+					editorRowGiveText(&E.rows[rec->row], rec->text, rec->length);
+					rec->text = NULL;
+				}
+				break;
+			case UNDO_ROW_INSERTED:
+				editorDelRow(rec->row);
+				break;
+			case UNDO_ROW_DELETED:
+				editorInsertRow(rec->row, rec->text, rec->length);
+				break;
+			case UNDO_ROWS_INSERTED:
+				editorDelRows(rec->row, rec->count);
+				break;
+			case UNDO_ROWS_DELETED:
+				if (rec->row > E.numberOfRows) { break; }
+				editorInsertRows(rec->row, rec->count);
+				for (i = 0; i < rec->count; i++) {
+					editorRowUseText(&E.rows[rec->row + i], rec->slices[i].text);
+					editorUpdateRow(&E.rows[rec->row + i]);
+				}
+				break;
+		}
+		free(rec->text);
+		if (rec->slices) { editorSlicesFree(rec->slices, rec->count); }
+	}
+	
+	//the first record in the group has where the cursor was before any of it happened
+	E.cx      = rec->cx;
+	E.cy      = rec->cy;
+	E.xScroll = rec->xScroll;
+	E.yScroll = rec->yScroll;
+	editorClampCursor();
+	
+	E.undoKind = UNDO_EDIT; //typing after an undo starts a new group
+	E.fileModified++;
+}
+
+/**** CLIPBOARD ****/
+/*
+	shift and the arrows select, ctrl-a selects everything, ctrl-c copies, ctrl-d cuts,
+	ctrl-v pastes and ctrl-y writes the clipboard out to a file
+	copying only shares the text of each row so it costs the same for a few bytes or for
+	hundreds of MB, pasting puts all the new rows in with one move of the rows after them
+	and the rows in the middle keep sharing the clipboards text till they are edited
+*/
+
+//where the cursor is as a row and a raw position, clamped onto the text
+void editorCursorRaw (int* row, int* raw) {
+	*row = getCurrentLineInFile();
+	if (*row >= E.numberOfRows) { *row = E.numberOfRows - 1; }
+	*raw = editorRowColToRaw(&E.rows[*row], getCursorPositionInRenderdFileLine());
+	if (*raw > E.rows[*row].rawLength) { *raw = E.rows[*row].rawLength; }
+}
+
+void editorCursorToRaw (int row, int raw) {
+	editorGoToLine(row, editorRowRawToCol(&E.rows[row], raw));
+}
+
+//gets the start and end of the selection in order, returns 0 if nothing is selected
+int editorSelectionRange (int* startRow, int* startRaw, int* endRow, int* endRaw) {
+	int anchorRow = E.selectRow;
+	int anchorRaw = E.selectRaw;
+	int row, raw;
+	
+	if (!E.selectActive || E.numberOfRows == 0) { return 0; }
+	
+	//rows can change under the anchor from the server or the file on disk
+	if (anchorRow >= E.numberOfRows) { anchorRow = E.numberOfRows - 1; }
+	if (anchorRaw > E.rows[anchorRow].rawLength) { anchorRaw = E.rows[anchorRow].rawLength; }
+	editorCursorRaw(&row, &raw);
+	
+	if (anchorRow < row || (anchorRow == row && anchorRaw < raw)) {
+		*startRow = anchorRow;
+		*startRaw = anchorRaw;
+		*endRow = row;
+		*endRaw = raw;
+	} else {
+		*startRow = row;
+		*startRaw = raw;
+		*endRow = anchorRow;
+		*endRaw = anchorRaw;
+	}
+	return *startRow != *endRow || *startRaw != *endRaw;
+}
+
+//the columns of a row that are selected, endCol is INT_MAX when the line break is selected too
+int editorSelectionCols (int line, int* startCol, int* endCol) {
+	int startRow, startRaw, endRow, endRaw;
+	
+	if (!editorSelectionRange(&startRow, &startRaw, &endRow, &endRaw)) { return 0; }
+	if (line < startRow || line > endRow) { return 0; }
+	
+	*startCol = (line == startRow) ? editorRowRawToCol(&E.rows[line], startRaw) : 0;
+	*endCol = (line == endRow) ? editorRowRawToCol(&E.rows[line], endRaw) : INT_MAX;
+	return 1;
+}
+
+//shift and an arrow starts a selection where the cursor is, then moves the cursor to grow it
+void editorSelectMove (int key) {
+	if (E.numberOfRows == 0) { return; }
+	if (!E.selectActive) {
+		editorCursorRaw(&E.selectRow, &E.selectRaw);
+		E.selectActive = 1;
+	}
+	
+	switch (key) {
+		case SHIFT_ARROW_UP:    editorMoveCursor(ARROW_UP); break;
+		case SHIFT_ARROW_DOWN:  editorMoveCursor(ARROW_DOWN); break;
+		case SHIFT_ARROW_LEFT:  editorMoveCursor(ARROW_LEFT); break;
+		case SHIFT_ARROW_RIGHT: editorMoveCursor(ARROW_RIGHT); break;
+	}
+}
+
+void editorSelectAll () {
+	int last = E.numberOfRows - 1;
+	
+	if (E.numberOfRows == 0) { return; }
+	E.selectActive = 1;
+	E.selectRow = 0;
+	E.selectRaw = 0;
+	editorCursorToRaw(last, E.rows[last].rawLength);
+}
+
+void editorClipboardSet (TextSlice* lines, int count) {
+	if (E.clipLines) { editorSlicesFree(E.clipLines, E.clipCount); }
+	E.clipLines = lines;
+	E.clipCount = count;
+}
+
+//how many bytes the clipboard would be with a new line between each line
+long long editorClipboardSize () {
+	long long size = (E.clipCount > 0) ? E.clipCount - 1 : 0;
+	int i;
+	
+	for (i = 0; i < E.clipCount; i++) { size += E.clipLines[i].length; }
+	return size;
+}
+
+int editorBase64 (const unsigned char* in, int length, char* out) {
+	const char* digits = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	int written = 0;
+	int i;
+	
+	for (i = 0; i < length; i += 3) {
+		unsigned int n = in[i] << 16;
+		
+		if (i + 1 < length) { n |= in[i + 1] << 8; }
+		if (i + 2 < length) { n |= in[i + 2]; }
+		out[written++] = digits[(n >> 18) & 63];
+		out[written++] = digits[(n >> 12) & 63];
+		out[written++] = (i + 1 < length) ? digits[(n >> 6) & 63] : '=';
+		out[written++] = (i + 2 < length) ? digits[n & 63] : '=';
+	}
+	return written;
+}
+
+/*
+	sends the clipboard to the terminal with OSC 52 so it can be pasted in other programs,
+	this is the only time the bytes are gathered up, and only when there are few enough of them
+	returns 0 if it was too big to send
+*/
+int editorClipboardExport () {
+	long long size = editorClipboardSize();
+	char* text;
+	char* out;
+	int length = 0;
+	int outLength;
+	int i;
+	
+	if (size > CLIPBOARD_OSC52_MAX) { return 0; }
+	
+	text = malloc(size + 1);
+	out = malloc((size + 2) / 3 * 4 + 16);
+	if (text == NULL || out == NULL) { die("malloc"); }
+	for (i = 0; i < E.clipCount; i++) {
+		if (i > 0) { text[length++] = '\n'; }
+		editorSliceCopy(&E.clipLines[i], &text[length]);
+		length += E.clipLines[i].length;
+	}
+	
+	memcpy(out, "\x1b]52;c;", 7);
+	outLength = 7 + editorBase64((unsigned char*)text, length, &out[7]);
+	out[outLength++] = '\x07';
+	write(STDOUT_FILENO, out, outLength);
+	
+	free(text);
+	free(out);
+	return 1;
+}
+
+//copies the selection onto the clipboard, returns 0 if nothing was selected
+int editorCopy () {
+	int startRow, startRaw, endRow, endRaw;
+	TextSlice* lines;
+	int count, i;
+	
+	if (!editorSelectionRange(&startRow, &startRaw, &endRow, &endRaw)) {
+		editorSetStatusMessage("Nothing is selected, hold shift and use the arrows to select");
+		return 0;
+	}
+	
+	count = endRow - startRow + 1;
+	lines = malloc(sizeof(TextSlice) * count);
+	if (lines == NULL) { die("malloc"); }
+	for (i = 0; i < count; i++) {
+		int row = startRow + i;
+		
+		lines[i].text = editorRowShare(&E.rows[row]);
+		lines[i].start = (row == startRow) ? startRaw : 0;
+		lines[i].length = ((row == endRow) ? endRaw : lines[i].text->rawLength) - lines[i].start;
+	}
+	editorClipboardSet(lines, count);
+	
+	if (editorClipboardExport()) {
+		editorSetStatusMessage("Copied %d lines", count);
+	} else {
+		editorSetStatusMessage("Copied %d lines, too big for the terminal, Ctrl-Y writes it to a file", count);
+	}
+	return 1;
+}
+
+/*
+	replaces deleteLength bytes of a row at "at" with text, the row is only rendered again
+	once, a row being made too long for rawChars turns into chunks when it is updated
+*/
+void editorRowSplice (EditorRow* row, int at, int deleteLength, const char* text, int length) {
+	if (row->hasGap) { editorRowCloseGap(row); }
+	editorRowOwnText(row);
+	
+	if (row->longRow) {
+		if (deleteLength > 0) { editorLongRowDelete(row, at, deleteLength); }
+		if (length > 0) { editorLongRowInsert(row, at, text, length); }
+	} else {
+		int newLength = row->rawLength - deleteLength + length;
+		
+		if (length > deleteLength) {
+			row->rawChars = realloc(row->rawChars, newLength + 1);
+			if (row->rawChars == NULL) { die("realloc"); }
+		}
+		memmove(&row->rawChars[at + length], &row->rawChars[at + deleteLength], row->rawLength - at - deleteLength);
+		memcpy(&row->rawChars[at], text, length);
+		row->rawLength = newLength;
+		row->rawChars[newLength] = '\0';
+	}
+	editorUpdateRow(row);
+}
+
+//deletes from start to end, the rows in between go in one go and undo keeps them without copying
+void editorDeleteRange (int startRow, int startRaw, int endRow, int endRaw) {
+	editorUndoSaveRow(startRow);
+	
+	if (endRow > startRow) {
+		EditorRow* last = &E.rows[endRow];
+		int tailLength = last->rawLength - endRaw;
+		char* tail = malloc(tailLength + 1);
+		
+		if (tail == NULL) { die("malloc"); }
+		editorRowCopy(last, endRaw, tailLength, tail);
+		editorUndoDeletedRows(startRow + 1, endRow - startRow);
+		editorDelRows(startRow + 1, endRow - startRow);
+		
+		editorRowSplice(&E.rows[startRow], startRaw, E.rows[startRow].rawLength - startRaw, tail, tailLength);
+		free(tail);
+	} else {
+		editorRowSplice(&E.rows[startRow], startRaw, endRaw - startRaw, "", 0);
+	}
+	
+	E.fileModified++;
+	editorCursorToRaw(startRow, startRaw);
+}
+
+void editorCut () {
+	int startRow, startRaw, endRow, endRaw;
+	
+	if (!editorCopy()) { return; }
+	editorSelectionRange(&startRow, &startRaw, &endRow, &endRaw);
+	
+	editorUndoBegin(UNDO_EDIT, startRow);
+	editorDeleteRange(startRow, startRaw, endRow, endRaw);
+	E.selectActive = 0;
+}
+
+/*
+	pastes the clipboard at the cursor, or over the selection if there is one
+	the first line is added to the end of the cursors row and the last line goes in front of
+	what was after the cursor, every row between is put in at once sharing the clipboards text
+*/
+void editorPaste () {
+	int startRow, startRaw, endRow, endRaw;
+	int line, at, count, i;
+	TextSlice* first;
+	TextSlice* last;
+	char* text;
+	
+	if (E.clipCount == 0) {
+		editorSetStatusMessage("Nothing to paste");
+		return;
+	}
+	
+	editorUndoBegin(UNDO_EDIT, getCurrentLineInFile());
+	if (editorSelectionRange(&startRow, &startRaw, &endRow, &endRaw)) {
+		editorDeleteRange(startRow, startRaw, endRow, endRaw);
+	}
+	E.selectActive = 0;
+	
+	line = getCurrentLineInFile();
+	if (line < 0 || line > E.numberOfRows) { return; }
+	if (line == E.numberOfRows) { //the cursor is on the line after the last row
+		editorInsertRow(line, "", 0);
+		editorUndoInsertedRow(line);
+	}
+	at = getCursorPositionInRawFileLine();
+	editorUndoSaveRow(line);
+	
+	count = E.clipCount;
+	first = &E.clipLines[0];
+	last = &E.clipLines[count - 1];
+	
+	if (count == 1) {
+		text = malloc(first->length + 1);
+		if (text == NULL) { die("malloc"); }
+		editorSliceCopy(first, text);
+		editorRowSplice(&E.rows[line], at, 0, text, first->length);
+		free(text);
+		editorCursorToRaw(line, at + first->length);
+	} else {
+		EditorRow* row = &E.rows[line];
+		int tailLength = row->rawLength - at;
+		
+		//the last row is the last line of the clipboard then the rest of the cursors row
+		text = malloc(last->length + tailLength + 1);
+		if (text == NULL) { die("malloc"); }
+		editorSliceCopy(last, text);
+		editorRowCopy(row, at, tailLength, &text[last->length]);
+		
+		editorInsertRows(line + 1, count - 1);
+		for (i = 1; i < count - 1; i++) {
+			TextSlice* slice = &E.clipLines[i];
+			EditorRow* added = &E.rows[line + i];
+			
+			if (slice->start == 0 && slice->length == slice->text->rawLength) {
+				editorRowUseText(added, slice->text);
+				editorUpdateRow(added);
+			} else {
+				char* part = malloc(slice->length + 1);
+				
+				if (part == NULL) { die("malloc"); }
+				editorSliceCopy(slice, part);
+				editorRowGiveText(added, part, slice->length);
+			}
+		}
+		editorRowGiveText(&E.rows[line + count - 1], text, last->length + tailLength);
+		editorUndoInsertedRows(line + 1, count - 1);
+		
+		text = malloc(first->length + 1);
+		if (text == NULL) { die("malloc"); }
+		editorSliceCopy(first, text);
+		editorRowSplice(&E.rows[line], at, tailLength, text, first->length);
+		free(text);
+		editorCursorToRaw(line + count - 1, last->length);
+	}
+	E.fileModified++;
+}
+
+//writes bytes to fd through buffer, big pieces go straight out, NULL data just empties the buffer
+//returns -1 if a write failed
+int editorClipboardWriteBytes (int fd, char* buffer, int* used, const char* data, int length) {
+	if (*used + length > CLIPBOARD_WRITE_SIZE || data == NULL) {
+		if (*used > 0 && write(fd, buffer, *used) != *used) { return -1; }
+		*used = 0;
+	}
+	if (data == NULL) { return 0; }
+	if (length >= CLIPBOARD_WRITE_SIZE) { return (write(fd, data, length) == length) ? 0 : -1; }
+	
+	memcpy(&buffer[*used], data, length);
+	*used += length;
+	return 0;
+}
+
+//writes the clipboard to fd straight out of the text it shares, so it is never gathered up in one piece
+int editorClipboardWriteFd (int fd) {
+	char* buffer = malloc(CLIPBOARD_WRITE_SIZE);
+	int used = 0;
+	int result = 0;
+	int i;
+	
+	if (buffer == NULL) { die("malloc"); }
+	for (i = 0; i < E.clipCount && result == 0; i++) {
+		TextSlice* slice = &E.clipLines[i];
+		LongRow* longRow = slice->text->longRow;
+		
+		if (i > 0) { result = editorClipboardWriteBytes(fd, buffer, &used, "\n", 1); }
+		if (longRow == NULL) {
+			if (result == 0) { result = editorClipboardWriteBytes(fd, buffer, &used, &slice->text->rawChars[slice->start], slice->length); }
+		} else {
+			int k = editorLongRowChunkIndexForRaw(longRow, slice->start);
+			int start = slice->start;
+			int end = slice->start + slice->length;
+			
+			while (result == 0 && start < end && k < longRow->count) {
+				RowChunk* chunk = &longRow->chunks[k++];
+				int offset = start - chunk->startRaw;
+				int n = chunk->length - offset;
+				
+				if (n > end - start) { n = end - start; }
+				result = editorClipboardWriteBytes(fd, buffer, &used, &chunk->data[offset], n);
+				start += n;
+			}
+		}
+	}
+	if (result == 0) { result = editorClipboardWriteBytes(fd, buffer, &used, NULL, 0); } //whatever is left in the buffer
+	
+	free(buffer);
+	return result;
+}
+
+void editorClipboardWrite () {
+	char* path;
+	int fd;
+	
+	if (E.clipCount == 0) {
+		editorSetStatusMessage("The clipboard is empty");
+		return;
+	}
+	
+	path = editorPrompt("Write clipboard to: %s (ESC to cancel)", NULL);
+	if (path == NULL) { return; }
+	
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd == -1) {
+		editorSetStatusMessage("Cant open %.40s: %s", path, strerror(errno));
+	} else {
+		if (editorClipboardWriteFd(fd) == -1) {
+			editorSetStatusMessage("Failed to write %.40s: %s", path, strerror(errno));
+		} else {
+			editorSetStatusMessage("Wrote %lld bytes to %.40s", editorClipboardSize(), path);
+		}
+		close(fd);
+	}
+	free(path);
+}
+
+//keys that leave the selection as it is, anything else drops it
+int editorSelectionKeepKey (int c) {
+	switch (c) {
+		case REDRAW_KEY:
+		case SHIFT_ARROW_UP:
+		case SHIFT_ARROW_DOWN:
+		case SHIFT_ARROW_LEFT:
+		case SHIFT_ARROW_RIGHT:
+		case CTRL_KEY('a'):
+		case CTRL_KEY('c'):
+		case CTRL_KEY('d'):
+		case CTRL_KEY('v'):
+		case CTRL_KEY('y'):
+			return 1;
+	}
+	return 0;
+}
+
+/**** ROW TREE ****/
+
+int editorRowTreeSize (int node) {
+	return node ? E.rowNodes[node].size : 0;
+}
+
+int editorRowNodeNew () {
+	RowNode* n;
+	int node;
+	
+	if (E.rowNodeFree) {
+		node = E.rowNodeFree;
+		E.rowNodeFree = E.rowNodes[node].left;
+	} else {
+		if (E.rowNodeCount == E.rowNodeCapacity) {
+			E.rowNodeCapacity = E.rowNodeCapacity ? E.rowNodeCapacity * 2 : 1024;
+			E.rowNodes = realloc(E.rowNodes, sizeof(RowNode) * E.rowNodeCapacity);
+			if (E.rowNodes == NULL) { die("realloc"); }
+		}
+		if (E.rowNodeCount == 0) { E.rowNodeCount = 1; } //node 0 is never used so 0 can mean none
+		node = E.rowNodeCount++;
+	}
+	
+	n = &E.rowNodes[node];
+	memset(n, 0, sizeof(RowNode));
+	n->size = 1;
+	n->priority = rand();
+	n->dirty = 1;
+	return node;
+}
+
+void editorRowNodeFreeAll (int node) {
+	if (node == 0) { return; }
+	editorRowNodeFreeAll(E.rowNodes[node].left);
+	editorRowNodeFreeAll(E.rowNodes[node].right);
+	E.rowNodes[node].left = E.rowNodeFree;
+	E.rowNodeFree = node;
+}
+
+//called after a node gets new children, its totals are left to be added up when they are read
+void editorRowTreeJoin (int node) {
+	RowNode* n = &E.rowNodes[node];
+	
+	n->size = 1 + editorRowTreeSize(n->left) + editorRowTreeSize(n->right);
+	n->dirty = 1;
+	if (n->left) { E.rowNodes[n->left].parent = node; }
+	if (n->right) { E.rowNodes[n->right].parent = node; }
+}
+
+//puts the first count rows under node in left and the rest in right
+void editorRowTreeSplit (int node, int count, int* left, int* right) {
+	RowNode* n;
+	
+	if (node == 0) {
+		*left = *right = 0;
+		return;
+	}
+	n = &E.rowNodes[node];
+	if (editorRowTreeSize(n->left) < count) {
+		editorRowTreeSplit(n->right, count - editorRowTreeSize(n->left) - 1, &n->right, right);
+		*left = node;
+	} else {
+		editorRowTreeSplit(n->left, count, left, &n->left);
+		*right = node;
+	}
+	editorRowTreeJoin(node);
+}
+
+//the rows under left then the rows under right as one tree
+int editorRowTreeMerge (int left, int right) {
+	int child;
+	
+	if (left == 0) { return right; }
+	if (right == 0) { return left; }
+	if (E.rowNodes[left].priority > E.rowNodes[right].priority) {
+		child = editorRowTreeMerge(E.rowNodes[left].right, right);
+		E.rowNodes[left].right = child;
+		editorRowTreeJoin(left);
+		return left;
+	}
+	child = editorRowTreeMerge(left, E.rowNodes[right].left);
+	E.rowNodes[right].left = child;
+	editorRowTreeJoin(right);
+	return right;
+}
+
+void editorRowTreeFix (int node) {
+	if (node == 0) { return; }
+	editorRowTreeFix(E.rowNodes[node].left);
+	editorRowTreeFix(E.rowNodes[node].right);
+	editorRowTreeJoin(node);
+}
+
+/*
+	gives the new rows from at on their nodes and puts them in the tree, the new nodes are made
+	into a tree of their own first in one pass, each goes under the last one with a bigger priority
+*/
+void editorRowTreeInsert (int at, int count) {
+	int* stack;
+	int top = 0;
+	int left, right, added, i;
+	
+	if (count <= 0) { return; }
+	stack = malloc(sizeof(int) * count);
+	if (stack == NULL) { die("malloc"); }
+	for (i = at; i < at + count; i++) {
+		int node = editorRowNodeNew();
+		int last = 0;
+		
+		E.rows[i].treeNode = node;
+		while (top > 0 && E.rowNodes[stack[top - 1]].priority < E.rowNodes[node].priority) { last = stack[--top]; }
+		E.rowNodes[node].left = last;
+		if (top > 0) { E.rowNodes[stack[top - 1]].right = node; }
+		stack[top++] = node;
+	}
+	added = stack[0];
+	free(stack);
+	editorRowTreeFix(added);
+	
+	editorRowTreeSplit(E.rowRoot, at, &left, &right);
+	E.rowRoot = editorRowTreeMerge(editorRowTreeMerge(left, added), right);
+	E.rowNodes[E.rowRoot].parent = 0;
+}
+
+void editorRowTreeDelete (int at, int count) {
+	int left, middle, right;
+	
+	editorRowTreeSplit(E.rowRoot, at, &left, &right);
+	editorRowTreeSplit(right, count, &middle, &right);
+	editorRowNodeFreeAll(middle);
+	E.rowRoot = editorRowTreeMerge(left, right);
+	if (E.rowRoot) { E.rowNodes[E.rowRoot].parent = 0; }
+}
+
+//marks the row's node and the ones above it, it stops at one already marked as those above it are too
+void editorRowTreeChanged (EditorRow* row) {
+	int node = row->treeNode;
+	
+	while (node && !E.rowNodes[node].dirty) {
+		E.rowNodes[node].dirty = 1;
+		node = E.rowNodes[node].parent;
+	}
+}
+
+//adds the totals up again where rows under node changed, lo is the first row under it
+void editorRowTreeClean (int node, int lo) {
+	RowNode* n;
+	int mid;
+	
+	if (node == 0 || !E.rowNodes[node].dirty) { return; }
+	n = &E.rowNodes[node];
+	mid = lo + editorRowTreeSize(n->left);
+	editorRowTreeClean(n->left, lo);
+	editorRowTreeClean(n->right, mid + 1);
+	
+	memset(&n->brackets, 0, sizeof(BracketSummary));
+	if (n->left) { n->brackets = E.rowNodes[n->left].brackets; }
+	editorBracketCombine(&n->brackets, &E.rows[mid].brackets);
+	if (n->right) { editorBracketCombine(&n->brackets, &E.rowNodes[n->right].brackets); }
+	n->visible = !E.rows[mid].hidden;
+	if (n->left) { n->visible += E.rowNodes[n->left].visible; }
+	if (n->right) { n->visible += E.rowNodes[n->right].visible; }
+	n->wrapLines = editorRowShownLines(mid);
+	if (n->left) { n->wrapLines += E.rowNodes[n->left].wrapLines; }
+	if (n->right) { n->wrapLines += E.rowNodes[n->right].wrapLines; }
+	n->dirty = 0;
+}
+
+/**** BRACKETS ****/
+
+//returns which kind of bracket c is or -1 if it isnt one, open is set for an opening bracket
+int editorBracketKind (char c, int* open) {
+	switch (c) {
+		case '(': *open = 1; return 0;
+		case ')': *open = 0; return 0;
+		case '[': *open = 1; return 1;
+		case ']': *open = 0; return 1;
+		case '{': *open = 1; return 2;
+		case '}': *open = 0; return 2;
+	}
+	return -1;
+}
+
+//adds the brackets in text onto the end of summary
+void editorBracketScan (BracketSummary* summary, const char* text, int length) {
+	int i, open, kind;
+	
+	for (i = 0; i < length; i++) {
+		if ((kind = editorBracketKind(text[i], &open)) == -1) { continue; }
+		
+		summary->sum[kind] += open ? 1 : -1;
+		if (summary->sum[kind] < summary->minPrefix[kind]) { summary->minPrefix[kind] = summary->sum[kind]; }
+		summary->maxSuffix[kind] += open ? 1 : -1;
+		if (summary->maxSuffix[kind] < 0) { summary->maxSuffix[kind] = 0; }
+	}
+}
+
+//adds the summary of the text that comes straight after onto summary
+void editorBracketCombine (BracketSummary* summary, const BracketSummary* next) {
+	int k;
+	
+	for (k = 0; k < BRACKET_KINDS; k++) {
+		int minPrefix = summary->sum[k] + next->minPrefix[k];
+		int maxSuffix = next->sum[k] + summary->maxSuffix[k];
+		
+		if (minPrefix < summary->minPrefix[k]) { summary->minPrefix[k] = minPrefix; }
+		summary->maxSuffix[k] = (maxSuffix > next->maxSuffix[k]) ? maxSuffix : next->maxSuffix[k];
+		summary->sum[k] += next->sum[k];
+	}
+}
+
+//called by editorUpdateRow, the totals above the row get added up again when they are next read
+void editorBracketRowChanged (EditorRow* row) {
+	editorRowTreeChanged(row);
+}
+
+/*
+	finds the first row from "from" on where the depth gets down to 0, whole nodes where it
+	cant are skipped, depth is left as it was at the start of the row that is returned
+	lo is the first row under node
+*/
+int editorBracketDescendForward (int node, int lo, int from, int kind, int* depth) {
+	RowNode* n;
+	BracketSummary* row;
+	int mid, found;
+	
+	if (node == 0 || lo + E.rowNodes[node].size <= from) { return -1; }
+	n = &E.rowNodes[node];
+	if (lo >= from && *depth + n->brackets.minPrefix[kind] > 0) {
+		*depth += n->brackets.sum[kind];
+		return -1;
+	}
+	
+	mid = lo + editorRowTreeSize(n->left);
+	found = editorBracketDescendForward(n->left, lo, from, kind, depth);
+	if (found != -1) { return found; }
+	if (mid >= from) {
+		row = &E.rows[mid].brackets;
+		if (*depth + row->minPrefix[kind] <= 0) { return mid; }
+		*depth += row->sum[kind];
+	}
+	return editorBracketDescendForward(n->right, mid + 1, from, kind, depth);
+}
+
+//the same going backwards through the rows before "to", depth is how many closes are unmatched
+int editorBracketDescendBackward (int node, int lo, int to, int kind, int* depth) {
+	RowNode* n;
+	BracketSummary* row;
+	int mid, found;
+	
+	if (node == 0 || lo >= to) { return -1; }
+	n = &E.rowNodes[node];
+	if (lo + n->size <= to && n->brackets.maxSuffix[kind] < *depth) {
+		*depth -= n->brackets.sum[kind];
+		return -1;
+	}
+	
+	mid = lo + editorRowTreeSize(n->left);
+	found = editorBracketDescendBackward(n->right, mid + 1, to, kind, depth);
+	if (found != -1) { return found; }
+	if (mid < to) {
+		row = &E.rows[mid].brackets;
+		if (row->maxSuffix[kind] >= *depth) { return mid; }
+		*depth -= row->sum[kind];
+	}
+	return editorBracketDescendBackward(n->left, lo, to, kind, depth);
+}
+
+//returns where the depth gets to 0 reading text forwards, or -1
+int editorBracketScanForward (const char* text, int length, int kind, int* depth) {
+	int i, open;
+	
+	for (i = 0; i < length; i++) {
+		if (editorBracketKind(text[i], &open) != kind) { continue; }
+		*depth += open ? 1 : -1;
+		if (*depth == 0) { return i; }
+	}
+	return -1;
+}
+
+int editorBracketScanBackward (const char* text, int length, int kind, int* depth) {
+	int i, open;
+	
+	for (i = length - 1; i >= 0; i--) {
+		if (editorBracketKind(text[i], &open) != kind) { continue; }
+		*depth += open ? -1 : 1;
+		if (*depth == 0) { return i; }
+	}
+	return -1;
+}
+
+//gives part of a row as one piece, long rows and the row with a gap are copied into scratch
+const char* editorRowRange (EditorRow* row, int start, int length, char** scratch) {
+	if (!row->longRow && !row->hasGap) { return &row->rawChars[start]; }
+	
+	*scratch = realloc(*scratch, length + 1);
+	if (*scratch == NULL) { die("realloc"); }
+	editorRowCopy(row, start, length, *scratch);
+	return *scratch;
+}
+
+/*
+	finds the bracket that matches the one at raw on line, returns 0 if there isnt a bracket
+	there or it has no match, only the row it starts on and the row it ends on are read
+*/
+int editorBracketFindMatch (int line, int raw, int* matchLine, int* matchRaw) {
+	EditorRow* row = &E.rows[line];
+	char* scratch = NULL;
+	const char* text;
+	int depth = 1;
+	int found = -1;
+	int open, kind;
+	
+	if (raw < 0 || raw >= row->rawLength) { return 0; }
+	if ((kind = editorBracketKind(editorRowByteAt(row, raw), &open)) == -1) { return 0; }
+	//the row with the gap doesnt have its brackets counted yet, so it cant be in the tree's part of the search
+	if (E.gapRow != -1 && E.gapRow != line) { editorRowCloseGap(&E.rows[E.gapRow]); }
+	editorRowTreeClean(E.rowRoot, 0);
+	
+	if (open) {
+		text = editorRowRange(row, raw + 1, row->rawLength - raw - 1, &scratch);
+		found = editorBracketScanForward(text, row->rawLength - raw - 1, kind, &depth);
+		if (found != -1) {
+			found += raw + 1;
+		} else if ((line = editorBracketDescendForward(E.rowRoot, 0, line + 1, kind, &depth)) != -1) {
+			row = &E.rows[line];
+			text = editorRowRange(row, 0, row->rawLength, &scratch);
+			found = editorBracketScanForward(text, row->rawLength, kind, &depth);
+		}
+	} else {
+		text = editorRowRange(row, 0, raw, &scratch);
+		found = editorBracketScanBackward(text, raw, kind, &depth);
+		if (found == -1 && (line = editorBracketDescendBackward(E.rowRoot, 0, line, kind, &depth)) != -1) {
+			row = &E.rows[line];
+			text = editorRowRange(row, 0, row->rawLength, &scratch);
+			found = editorBracketScanBackward(text, row->rawLength, kind, &depth);
+		}
+	}
+	
+	free(scratch);
+	if (found == -1) { return 0; }
+	*matchLine = line;
+	*matchRaw = found;
+	return 1;
+}
+
+//works out which brackets to highlight, called before each redraw
+void editorUpdateBracketMatch () {
+	int line = getCurrentLineInFile();
+	int raw, matchLine, matchRaw;
+	
+	E.bracketLine[0] = E.bracketLine[1] = -1;
+	if (line < 0 || line >= E.numberOfRows) { return; }
+	
+	raw = getCursorPositionInRawFileLine();
+	if (!editorBracketFindMatch(line, raw, &matchLine, &matchRaw)) { return; }
+	
+	E.bracketLine[0] = line;
+	E.bracketCol[0]  = editorRowRawToCol(&E.rows[line], raw);
+	E.bracketLine[1] = matchLine;
+	E.bracketCol[1]  = editorRowRawToCol(&E.rows[matchLine], matchRaw);
+}
+
+int editorIsBracketMatch (int line, int col) {
+	return (E.bracketLine[0] == line && E.bracketCol[0] == col) || (E.bracketLine[1] == line && E.bracketCol[1] == col);
+}
+
+void editorJumpToBracket () {
+	editorUpdateBracketMatch();
+	if (E.bracketLine[1] == -1) {
+		editorSetStatusMessage("No matching bracket");
+		return;
+	}
+	editorGoToLine(E.bracketLine[1], E.bracketCol[1]);
+}
+
+/**** WORD INDEX ****/
+/*
+	every word in the rows goes in a ternary search tree with a count of how many times it is
+	used, so completing a word is a walk down to where its start ends and a look under there
+	each node keeps the most any word under it is used, so the look only goes where a word could
+	be one of the most used, and words no one uses any more are taken out so their nodes can be used again
+	each row keeps the nodes of the words it added, a changed row takes them back out and puts
+	its new words in, so a change only costs as much as the row it is in
+	the row being typed in keeps its old words until the gap is closed, so typing doesnt copy the row
+	rows are put in by a background thread after the file is opened, rows past wordNext havent
+	been done yet so changes to them are left for it
+*/
+
+int editorWordChar (unsigned char c) {
+	return isalnum(c) || c == '_' || c >= 0x80; //bytes of utf-8 letters are kept in words
+}
+
+//the link from parent to its child on side, 0 is the root
+int* editorWordLink (int parent, int side) {
+	if (side == 0) { return &E.wordRoot; }
+	if (side < 0) { return &E.wordNodes[parent].lo; }
+	if (side > 1) { return &E.wordNodes[parent].hi; }
+	return &E.wordNodes[parent].eq;
+}
+
+int editorWordNewNode (unsigned char c, int parent) {
+	WordNode* node;
+	int id;
+	
+	if (E.wordFree) {
+		id = E.wordFree;
+		E.wordFree = E.wordNodes[id].eq;
+	} else {
+		if (E.wordNodeCount == E.wordNodeCapacity) {
+			E.wordNodeCapacity = E.wordNodeCapacity ? E.wordNodeCapacity * 2 : 1024;
+			E.wordNodes = realloc(E.wordNodes, sizeof(WordNode) * E.wordNodeCapacity);
+			if (E.wordNodes == NULL) { die("realloc"); }
+		}
+		if (E.wordNodeCount == 0) { E.wordNodeCount = 1; } //node 0 is never used so 0 can mean none
+		id = E.wordNodeCount++;
+	}
+	
+	node = &E.wordNodes[id];
+	node->c = c;
+	node->count = 0;
+	node->best = 0;
+	node->lo = node->eq = node->hi = 0;
+	node->parent = parent;
+	return id;
+}
+
+int editorWordBest (int node) {
+	return node ? E.wordNodes[node].best : 0;
+}
+
+/*
+	changes how many times the word ending on node is used, a word that isnt used any more is
+	taken out with the nodes only it needed, then the best counts above are put right up to
+	the first one that doesnt change
+*/
+void editorWordCount (int node, int change) {
+	E.wordNodes[node].count += change;
+	
+	while (node && E.wordNodes[node].count == 0 && !E.wordNodes[node].lo && !E.wordNodes[node].eq && !E.wordNodes[node].hi) {
+		WordNode* n = &E.wordNodes[node];
+		int parent = n->parent;
+		int* link = &E.wordRoot;
+		
+		if (parent) {
+			WordNode* p = &E.wordNodes[parent];
+			
+			link = (p->lo == node) ? &p->lo : (p->eq == node) ? &p->eq : &p->hi;
+		}
+		*link = 0;
+		n->eq = E.wordFree;
+		E.wordFree = node;
+		node = parent;
+	}
+	
+	while (node) {
+		WordNode* n = &E.wordNodes[node];
+		int best = n->count;
+		
+		if (editorWordBest(n->lo) > best) { best = editorWordBest(n->lo); }
+		if (editorWordBest(n->eq) > best) { best = editorWordBest(n->eq); }
+		if (editorWordBest(n->hi) > best) { best = editorWordBest(n->hi); }
+		if (best == n->best) { break; }
+		n->best = best;
+		node = n->parent;
+	}
+}
+
+//the node the word ends on, made if it isnt there when add is set, otherwise 0 if it isnt there
+int editorWordNode (const char* word, int length, int add) {
+	int parent = 0;
+	int side = 0;
+	int node = E.wordRoot;
+	int i = 0;
+	
+	while (1) {
+		unsigned char c = word[i];
+		WordNode* n;
+		
+		if (node == 0) {
+			if (!add) { return 0; }
+			node = editorWordNewNode(c, parent);
+			*editorWordLink(parent, side) = node; //after the new node as that can move the array
+		}
+		n = &E.wordNodes[node];
+		
+		parent = node;
+		if (c < n->c) {
+			side = -1;
+			node = n->lo;
+		} else if (c > n->c) {
+			side = 2;
+			node = n->hi;
+		} else if (++i == length) {
+			return node;
+		} else {
+			side = 1;
+			node = n->eq;
+		}
+	}
+}
+
+//puts the words of a row in the index and adds it to the word and charicter counts
+void editorWordIndexRow (EditorRow* row) {
+	char* text = row->rawChars;
+	int length = row->rawLength;
+	int ids = 0;
+	int capacity = 0;
+	int i = 0;
+	
+	//rows split into chunks or with a gap are copied out so words across the joins arent cut
+	if (row->longRow || row->hasGap) {
+		text = malloc(length + 1);
+		if (text == NULL) { die("malloc"); }
+		editorRowCopy(row, 0, length, text);
+	}
+	
+	row->wordTotal = 0;
+	row->charTotal = 0;
+	for (i = 0; i < length; i++) {
+		if (((unsigned char)text[i] & 0xc0) != 0x80) { row->charTotal++; } //utf-8 continuation bytes arent charicters
+	}
+	
+	i = 0;
+	while (i < length) {
+		int start;
+		
+		while (i < length && !editorWordChar(text[i])) { i++; }
+		if (i == length) { break; }
+		start = i;
+		while (i < length && editorWordChar(text[i])) { i++; }
+		
+		row->wordTotal++;
+		if (i - start > WORD_MAX_LENGTH) { continue; }
+		if (ids == capacity) {
+			capacity = capacity ? capacity * 2 : 8;
+			row->wordIds = realloc(row->wordIds, sizeof(int) * capacity);
+			if (row->wordIds == NULL) { die("realloc"); }
+		}
+		row->wordIds[ids] = editorWordNode(&text[start], i - start, 1);
+		editorWordCount(row->wordIds[ids], 1);
+		ids++;
+	}
+	row->wordIdCount = ids;
+	
+	E.wordTotal += row->wordTotal;
+	E.charTotal += row->charTotal;
+	if (text != row->rawChars) { free(text); }
+}
+
+void editorWordUnindexRow (EditorRow* row) {
+	int i;
+	
+	for (i = 0; i < row->wordIdCount; i++) { editorWordCount(row->wordIds[i], -1); }
+	free(row->wordIds);
+	row->wordIds = NULL;
+	row->wordIdCount = 0;
+	E.wordTotal -= row->wordTotal;
+	E.charTotal -= row->charTotal;
+	row->wordTotal = 0;
+	row->charTotal = 0;
+}
+
+//very long rows would be read through on every key, so like highlighting they keep what they had
+void editorWordRowChanged (EditorRow* row) {
+	if (row - E.rows >= E.wordNext || row->rawLength > WORD_REINDEX_MAX) { return; }
+	editorWordUnindexRow(row);
+	editorWordIndexRow(row);
+}
+
+//called before a row is put in at row, one put in before wordNext is indexed when it is updated
+void editorWordRowAdded (int row) {
+	if (row < E.wordNext) { E.wordNext++; }
+	else { pthread_cond_signal(&E.wordReady); }
+}
+
+void editorWordRowDeleted (int row) {
+	if (row >= E.wordNext) { return; }
+	editorWordUnindexRow(&E.rows[row]);
+	E.wordNext--;
+}
+
+//indexes rows in batches, letting go of the lock between them so the ui can get in
+void* editorWordThread (void* arg) {
+	editorLockRows();
+	while (1) {
+		int batch = 0;
+		
+		while (E.wordNext >= E.numberOfRows) { pthread_cond_wait(&E.wordReady, &E.rowsLock); }
+		while (E.wordNext < E.numberOfRows && batch++ < WORD_INDEX_BATCH) {
+			editorWordIndexRow(&E.rows[E.wordNext]);
+			E.wordNext++;
+		}
+		
+		editorUnlockRows();
+		editorRequestRedraw(); //the counts in the status bar have gone up
+		editorLockRows();
+	}
+	return NULL;
+}
+
+void editorWordIndexStart () {
+	pthread_t thread;
+	
+	pthread_cond_init(&E.wordReady, NULL);
+	if (pthread_create(&thread, NULL, editorWordThread, NULL) != 0) { die("pthread_create"); }
+	pthread_detach(thread);
+}
+
+/*
+	keeps the WORD_COMPLETE_MAX most used words under node in found, most used first, word has the
+	letters on the way down in it, the words are gone through in order so ones used as much stay
+	in order and a subtree whose best cant beat the least used one kept is skipped
+*/
+void editorWordCollect (int node, char* word, int depth, char** found, int* uses, int* count) {
+	WordNode* n;
+	
+	if (node == 0 || (*count == WORD_COMPLETE_MAX && E.wordNodes[node].best <= uses[*count - 1])) { return; }
+	n = &E.wordNodes[node];
+	
+	editorWordCollect(n->lo, word, depth, found, uses, count);
+	
+	word[depth] = n->c;
+	if (n->count > 0 && (*count < WORD_COMPLETE_MAX || n->count > uses[*count - 1])) {
+		int at;
+		
+		if (*count == WORD_COMPLETE_MAX) { free(found[--(*count)]); } //the least used one makes room
+		at = (*count)++;
+		while (at > 0 && uses[at - 1] < n->count) {
+			found[at] = found[at - 1];
+			uses[at] = uses[at - 1];
+			at--;
+		}
+		found[at] = malloc(depth + 2);
+		if (found[at] == NULL) { die("malloc"); }
+		memcpy(found[at], word, depth + 1);
+		found[at][depth + 1] = '\0';
+		uses[at] = n->count;
+	}
+	if (depth + 1 < WORD_MAX_LENGTH) { editorWordCollect(n->eq, word, depth + 1, found, uses, count); }
+	
+	editorWordCollect(n->hi, word, depth, found, uses, count);
+}
+
+int editorWordUses (const char* word) {
+	int node = editorWordNode(word, strlen(word), 0);
+	
+	return node ? E.wordNodes[node].count : 0;
+}
+
+void editorCompleteClear () {
+	int i;
+	
+	for (i = 0; i < E.completeCount; i++) { free(E.completeWords[i]); }
+	E.completeCount = 0;
+}
+
+//finds the words that start with prefix and keeps the most used ones for ctrl-n to go round
+int editorCompleteFind (const char* prefix, int length) {
+	int uses[WORD_COMPLETE_MAX];
+	char word[WORD_MAX_LENGTH + 1];
+	int node = editorWordNode(prefix, length, 0);
+	
+	editorCompleteClear();
+	if (node == 0) { return 0; }
+	
+	memcpy(word, prefix, length);
+	editorWordCollect(E.wordNodes[node].eq, word, length, E.completeWords, uses, &E.completeCount);
+	return E.completeCount;
+}
+
+/*
+	finishes the word before the cursor with a word from the index, pressing it again straight
+	after swaps in the next one, the row is changed as one piece so it undoes like typing
+*/
+void editorComplete () {
+	int line = getCurrentLineInFile();
+	int at = getCursorPositionInRawFileLine();
+	const char* word;
+	EditorRow* row;
+	char* text;
+	char* newText;
+	int length, wordLength, newLength, end;
+	
+	if (line < 0 || line >= E.numberOfRows) { return; }
+	row = &E.rows[line];
+	
+	if (E.completeCount > 0 && line == E.completeLine && at == E.completeEnd) {
+		E.completeIndex = (E.completeIndex + 1) % E.completeCount;
+	} else {
+		char prefix[WORD_MAX_LENGTH];
+		int start = at;
+		
+		while (start > 0 && at - start < WORD_MAX_LENGTH && editorWordChar(editorRowByteAt(row, start - 1))) { start--; }
+		if (start == at) {
+			editorSetStatusMessage("No word before the cursor to complete");
+			return;
+		}
+		
+		editorRowCopy(row, start, at - start, prefix);
+		if (editorCompleteFind(prefix, at - start) == 0) {
+			editorSetStatusMessage("Nothing to complete %.*s with", at - start, prefix);
+			return;
+		}
+		E.completeLine = line;
+		E.completeStart = start;
+		E.completeLength = at - start;
+		E.completeIndex = 0;
+	}
+	
+	//whatever the last completion put in is swapped for this one
+	word = E.completeWords[E.completeIndex];
+	wordLength = strlen(word) - E.completeLength;
+	end = E.completeStart + E.completeLength;
+	
+	editorUndoBegin(UNDO_TYPING, line);
+	editorUndoSaveRow(line);
+	text = editorRowTakeText(row, &length);
+	newLength = end + wordLength + (length - at);
+	newText = malloc(newLength + 1);
+	if (newText == NULL) { die("malloc"); }
+	memcpy(newText, text, end);
+	memcpy(&newText[end], &word[E.completeLength], wordLength);
+	memcpy(&newText[end + wordLength], &text[at], length - at);
+	free(text);
+	editorRowGiveText(row, newText, newLength);
+	
+	E.completeEnd = end + wordLength;
+	editorSetCursorCol(editorRowRawToCol(row, E.completeEnd));
+	E.fileModified++;
+	editorSetStatusMessage("%s (%d/%d, used %d times)", word, E.completeIndex + 1, E.completeCount, editorWordUses(word));
+}
+
+/**** FOLDING ****/
+
+//where row is in filterRows, or where it would go
+int editorFilterLowerBound (int row) {
+	int lo = 0;
+	int hi = E.filterCount;
+	
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		
+		if (E.filterRows[mid] < row) { lo = mid + 1; }
+		else { hi = mid; }
+	}
+	return lo;
+}
+
+//the row that is shown on a visible line, lines past the end carry on counting from the last row
+int editorVisibleToRow (int visible) {
+	int node = E.rowRoot;
+	int lo = 0;
+	
+	if (E.filterActive && visible >= 0) {
+		if (visible < E.filterCount) { return E.filterRows[visible]; }
+		return E.numberOfRows + visible - E.filterCount;
+	}
+	if (E.hiddenRows == 0 || visible < 0) { return visible; }
+	editorRowTreeClean(E.rowRoot, 0);
+	if (visible >= E.rowNodes[node].visible) { return E.numberOfRows + visible - E.rowNodes[node].visible; }
+	
+	while (1) {
+		RowNode* n = &E.rowNodes[node];
+		int left = n->left ? E.rowNodes[n->left].visible : 0;
+		int mid = lo + editorRowTreeSize(n->left);
+		
+		if (visible < left) {
+			node = n->left;
+			continue;
+		}
+		visible -= left;
+		if (!E.rows[mid].hidden) {
+			if (visible == 0) { return mid; }
+			visible--;
+		}
+		node = n->right;
+		lo = mid + 1;
+	}
+}
+
+//how many visible lines come before row
+int editorRowToVisible (int row) {
+	int node = E.rowRoot;
+	int lo = 0;
+	int visible = 0;
+	int extra = 0;
+	
+	if (E.filterActive && row >= 0) {
+		if (row >= E.numberOfRows) { return E.filterCount + row - E.numberOfRows; }
+		return editorFilterLowerBound(row);
+	}
+	if (E.hiddenRows == 0 || row <= 0) { return row; }
+	editorRowTreeClean(E.rowRoot, 0);
+	
+	if (row > E.numberOfRows) {
+		extra = row - E.numberOfRows;
+		row = E.numberOfRows;
+	}
+	//every node the walk goes right from counts the rows on its left and itself
+	while (node) {
+		RowNode* n = &E.rowNodes[node];
+		int mid = lo + editorRowTreeSize(n->left);
+		
+		if (row <= mid) {
+			node = n->left;
+			continue;
+		}
+		if (n->left) { visible += E.rowNodes[n->left].visible; }
+		visible += !E.rows[mid].hidden;
+		node = n->right;
+		lo = mid + 1;
+	}
+	return visible + extra;
+}
+
+int editorVisibleCount () {
+	return editorRowToVisible(E.numberOfRows);
+}
+
+//the next row that is drawn after row
+int editorNextVisibleRow (int row) {
+	if (E.filterActive) {
+		int i = editorFilterLowerBound(row + 1);
+		return (i < E.filterCount) ? E.filterRows[i] : E.numberOfRows;
+	}
+	return row + 1 + E.rows[row].foldedRows;
+}
+
+//puts row in the filter while filtering, otherwise opens any folds it is in
+void editorMakeRowVisible (int row) {
+	if (E.filterActive) {
+		int i = editorFilterLowerBound(row);
+		
+		if (i < E.filterCount && E.filterRows[i] == row) { return; }
+		if (E.filterCount == E.filterCapacity) {
+			E.filterCapacity = E.filterCapacity ? E.filterCapacity * 2 : 64;
+			E.filterRows = realloc(E.filterRows, sizeof(int) * E.filterCapacity);
+			if (E.filterRows == NULL) { die("realloc"); }
+		}
+		memmove(&E.filterRows[i + 1], &E.filterRows[i], sizeof(int) * (E.filterCount - i));
+		E.filterRows[i] = row;
+		E.filterCount++;
+		E.rows[row].filtered = 1;
+		editorRowTreeChanged(&E.rows[row]);
+	} else if (E.rows[row].hidden) {
+		editorUnfoldContaining(row);
+	}
+}
+
+void editorFilterRemoveRow (int row) {
+	//the row just read in is the last one, so it is taken off the end without a search
+	int i = (E.filterCount > 0 && E.filterRows[E.filterCount - 1] == row) ? E.filterCount - 1 : editorFilterLowerBound(row);
+	
+	if (i == E.filterCount || E.filterRows[i] != row) { return; }
+	memmove(&E.filterRows[i], &E.filterRows[i + 1], sizeof(int) * (E.filterCount - i - 1));
+	E.filterCount--;
+	E.rows[row].filtered = 0;
+	editorRowTreeChanged(&E.rows[row]);
+}
+
+//rows after the new ones move down by count, and the new rows are shown so they can be typed in
+void editorFilterRowsInserted (int at, int count) {
+	int first, i;
+	
+	if (!E.filterActive) { return; }
+	first = (at == E.numberOfRows) ? E.filterCount : editorFilterLowerBound(at); //rows read in go on the end, with nothing after them to move
+	for (i = first; i < E.filterCount; i++) { E.filterRows[i] += count; }
+	
+	if (E.filterCount + count > E.filterCapacity) {
+		E.filterCapacity = E.filterCapacity ? E.filterCapacity * 2 : 64;
+		if (E.filterCapacity < E.filterCount + count) { E.filterCapacity = E.filterCount + count; }
+		E.filterRows = realloc(E.filterRows, sizeof(int) * E.filterCapacity);
+		if (E.filterRows == NULL) { die("realloc"); }
+	}
+	memmove(&E.filterRows[first + count], &E.filterRows[first], sizeof(int) * (E.filterCount - first));
+	for (i = 0; i < count; i++) {
+		E.filterRows[first + i] = at + i;
+		E.rows[at + i].filtered = 1;
+		editorRowTreeChanged(&E.rows[at + i]);
+	}
+	E.filterCount += count;
+}
+
+//the rows from at go and the rows after them move up by count, their nodes go with them so the tree isnt told
+void editorFilterRowsDeleted (int at, int count) {
+	int first, last, i;
+	
+	if (!E.filterActive) { return; }
+	first = editorFilterLowerBound(at);
+	last = editorFilterLowerBound(at + count);
+	memmove(&E.filterRows[first], &E.filterRows[last], sizeof(int) * (E.filterCount - last));
+	E.filterCount -= last - first;
+	for (i = first; i < E.filterCount; i++) { E.filterRows[i] -= count; }
+}
+
+//hides the rows after start up to end behind start, folds already in the range stay folded inside it
+void editorFold (int start, int end) {
+	int i;
+	
+	if (end >= E.numberOfRows) { end = E.numberOfRows - 1; }
+	if (start < 0 || end <= start || E.rows[start].hidden) { return; }
+	if (start + E.rows[start].foldedRows > end) { end = start + E.rows[start].foldedRows; }
+	
+	for (i = start + 1; i <= end; i++) {
+		if (E.rows[i].foldedRows && i + E.rows[i].foldedRows > end) { end = i + E.rows[i].foldedRows; }
+		if (!E.rows[i].hidden) {
+			E.rows[i].hidden = 1;
+			E.hiddenRows++;
+			editorRowTreeChanged(&E.rows[i]);
+		}
+	}
+	E.rows[start].foldedRows = end - start;
+}
+
+void editorUnfold (int head) {
+	int end = head + E.rows[head].foldedRows;
+	int i = head + 1;
+	
+	E.rows[head].foldedRows = 0;
+	while (i <= end) {
+		E.rows[i].hidden = 0;
+		E.hiddenRows--;
+		editorRowTreeChanged(&E.rows[i]);
+		i += 1 + E.rows[i].foldedRows; //rows in a fold inside this one stay hidden
+	}
+}
+
+//opens every fold that row is hidden in, starting with the outside one
+void editorUnfoldContaining (int row) {
+	while (E.rows[row].hidden) {
+		int head = row - 1;
+		
+		while (E.rows[head].hidden) { head--; }
+		editorUnfold(head);
+	}
+}
+
+//how many columns of space or tab a row starts with, -1 for a blank row
+int editorRowIndent (EditorRow* row) {
+	int col = 0;
+	int at;
+	
+	for (at = 0; at < row->rawLength; at++) {
+		char c = editorRowByteAt(row, at);
+		
+		if (c == ' ') { col++; }
+		else if (c == '\t') { col += TAB_SIZE - (col % TAB_SIZE); }
+		else { return col; }
+	}
+	return -1;
+}
+
+//the row a block opened by the last '{' on line is closed on, or -1
+int editorBraceBlockEnd (int line) {
+	EditorRow* row = &E.rows[line];
+	int at, matchLine, matchRaw;
+	
+	for (at = row->rawLength - 1; at >= 0; at--) {
+		if (editorRowByteAt(row, at) != '{') { continue; }
+		if (editorBracketFindMatch(line, at, &matchLine, &matchRaw) && matchLine > line) { return matchLine; }
+	}
+	return -1;
+}
+
+//the last row of the block indented further than line, blank rows at the end are left out
+int editorIndentBlockEnd (int line) {
+	int indent = editorRowIndent(&E.rows[line]);
+	int end = -1;
+	int i;
+	
+	if (indent == -1) { return -1; }
+	for (i = line + 1; i < E.numberOfRows; i++) {
+		int rowIndent = editorRowIndent(&E.rows[i]);
+		
+		if (rowIndent == -1) { continue; }
+		if (rowIndent <= indent) { break; }
+		end = i;
+	}
+	return end;
+}
+
+//folds the brace block or the indented block under the cursor, or opens it if it is folded
+void editorToggleFold () {
+	int line = getCurrentLineInFile();
+	int end;
+	
+	if (line < 0 || line >= E.numberOfRows) { return; }
+	if (E.filterActive) {
+		editorSetStatusMessage("Folding is off while filtering");
+		return;
+	}
+	if (E.rows[line].foldedRows) {
+		editorUnfold(line);
+		return;
+	}
+	
+	end = editorBraceBlockEnd(line);
+	if (end == -1) { end = editorIndentBlockEnd(line); }
+	if (end == -1) {
+		editorSetStatusMessage("Nothing to fold here");
+		return;
+	}
+	editorFold(line, end);
+	editorSetStatusMessage("Folded %d lines", E.rows[line].foldedRows);
+}
+
+//folds from the cursor to a line that is typed in
+void editorFoldToLine () {
+	char* input = editorPrompt("Fold to line: %s (ESC to leave)", NULL);
+	int line = getCurrentLineInFile();
+	int target;
+	
+	if (input == NULL) { return; }
+	target = atoi(input);
+	free(input);
+	
+	if (E.filterActive) {
+		editorSetStatusMessage("Folding is off while filtering");
+		return;
+	}	
+	if (target < 0 || target >= E.numberOfRows || line >= E.numberOfRows) {
+		editorSetStatusMessage("No line %d", target);
+		return;
+	}
+	if (target < line) { //folding upwards, the fold starts at the target so the cursor goes there
+		int swap = line;
+		
+		line = target;
+		target = swap;
+	}
+	editorFold(line, target);
+	editorGoToLine(line, 0);
+}
+
+/**** SOFT WRAP ****/
+
+int editorWrapWidth () {
+	int width = E.screenCols - LINE_START_SIZE;
+	
+	return (width > 0) ? width : 1;
+}
+
+//a row that exactly fills its last line gets an empty one after it for the cursor to go on
+int editorRowWrapLines (EditorRow* row) {
+	return editorRowCols(row) / editorWrapWidth() + 1;
+}
+
+//every row's lines are worked out again and the row tree adds them all up again when it is next read
+void editorWrapTreeBuild () {
+	int i;
+	
+	//the rows keep their width so a resize only divides again, it doesnt walk the text
+	E.wrapWidth = editorWrapWidth();
+	for (i = 0; i < E.numberOfRows; i++) { E.rows[i].wrapLines = editorRowWrapLines(&E.rows[i]); }
+	for (i = 1; i < E.rowNodeCount; i++) { E.rowNodes[i].dirty = 1; }
+	E.wrapTreeDirty = 0;
+}
+
+void editorWrapEnsure () {
+	if (E.wrapTreeDirty || E.wrapWidth != editorWrapWidth()) { editorWrapTreeBuild(); }
+	editorRowTreeClean(E.rowRoot, 0);
+}
+
+//a row that was changed only moves its own weight in the tree
+void editorWrapRowChanged (EditorRow* row) {
+	int lines;
+	
+	if (!E.wrapActive || E.wrapTreeDirty) { return; }
+	lines = editorRowWrapLines(row);
+	if (lines == row->wrapLines) { return; }
+	row->wrapLines = lines;
+	editorRowTreeChanged(row);
+}
+
+//the screen lines a row takes up in the tree, a row that isnt shown takes up none
+int editorRowShownLines (int row) {
+	EditorRow* r = &E.rows[row];
+	
+	if (E.filterActive ? !r->filtered : r->hidden) { return 0; }
+	return r->wrapLines;
+}
+
+//how many screen lines the visible lines before this one take up, lines past the end count one each
+int editorWrapLinesBefore (int visible) {
+	int node = E.rowRoot;
+	int lo = 0;
+	int lines = 0;
+	int count, row;
+	
+	editorWrapEnsure();
+	if (visible <= 0) { return visible; }
+	count = editorVisibleCount();
+	if (visible >= count) { return (node ? E.rowNodes[node].wrapLines : 0) + visible - count; }
+	
+	row = editorVisibleToRow(visible);
+	while (node) {
+		RowNode* n = &E.rowNodes[node];
+		int mid = lo + editorRowTreeSize(n->left);
+		
+		if (row <= mid) {
+			node = n->left;
+			continue;
+		}
+		if (n->left) { lines += E.rowNodes[n->left].wrapLines; }
+		lines += editorRowShownLines(mid);
+		node = n->right;
+		lo = mid + 1;
+	}
+	return lines;
+}
+
+//the visible line a screen line is part of, and how far down that line it is
+int editorWrapVisibleAt (int screenLine, int* sub) {
+	int node = E.rowRoot;
+	int lo = 0;
+	int total;
+	
+	editorWrapEnsure();
+	if (screenLine < 0) { screenLine = 0; }
+	total = node ? E.rowNodes[node].wrapLines : 0;
+	if (screenLine >= total) { //past the last row
+		*sub = 0;
+		return editorVisibleCount() + screenLine - total;
+	}
+	
+	while (1) {
+		RowNode* n = &E.rowNodes[node];
+		int left = n->left ? E.rowNodes[n->left].wrapLines : 0;
+		int mid = lo + editorRowTreeSize(n->left);
+		int own;
+		
+		if (screenLine < left) {
+			node = n->left;
+			continue;
+		}
+		screenLine -= left;
+		own = editorRowShownLines(mid);
+		if (screenLine < own) {
+			*sub = screenLine;
+			return editorRowToVisible(mid);
+		}
+		screenLine -= own;
+		node = n->right;
+		lo = mid + 1;
+	}
+}
+
+//which of its screen lines the cursor is on
+int editorWrapCursorSub (int visible, int col) {
+	int sub = col / editorWrapWidth();
+	int row = editorVisibleToRow(visible);
+	
+	if (row < E.numberOfRows && sub >= E.rows[row].wrapLines) { sub = E.rows[row].wrapLines - 1; }
+	return sub;
+}
+
+//puts yScroll and cy back in visible lines once wrapTop has moved
+void editorWrapSetTop (int visible) {
+	int sub;
+	
+	E.yScroll = editorWrapVisibleAt(E.wrapTop, &sub);
+	E.cy = HEADER_SIZE + visible - E.yScroll;
+	E.wrapYScroll = E.yScroll;
+}
+
+/*
+	keeps the cursor on screen, called before drawing, if yScroll was moved by something that
+	doesnt know about wrapping then the top goes to the start of that row
+*/
+void editorWrapScrollToCursor () {
+	int textRows = E.screenRows - HEADER_SIZE - 1;
+	int visible = E.cy + E.yScroll - HEADER_SIZE;
+	int col = getCursorPositionInRenderdFileLine();
+	int sub, cursorLine;
+	
+	if (textRows < 1) { textRows = 1; }
+	if (E.yScroll != E.wrapYScroll) { E.wrapTop = editorWrapLinesBefore(E.yScroll); }
+	
+	sub = editorWrapCursorSub(visible, col);
+	cursorLine = editorWrapLinesBefore(visible) + sub;
+	if (cursorLine < E.wrapTop) { E.wrapTop = cursorLine; }
+	if (cursorLine >= E.wrapTop + textRows) { E.wrapTop = cursorLine - textRows + 1; }
+	editorWrapSetTop(visible);
+	
+	E.wrapCursorY = HEADER_SIZE + cursorLine - E.wrapTop;
+	E.wrapCursorX = LINE_START_SIZE + col - sub * editorWrapWidth();
+}
+
+/*
+	page up and down move one screen line at a time when wrapping so a row many lines long
+	can be read through, the cursor is pulled along if it would go off screen
+*/
+void editorWrapScroll (int offset) {
+	int textRows = E.screenRows - HEADER_SIZE - 1;
+	int total = editorWrapLinesBefore(editorVisibleCount());
+	int visible = E.cy + E.yScroll - HEADER_SIZE;
+	int col = getCursorPositionInRenderdFileLine();
+	int width = editorWrapWidth();
+	int cursorLine, target, sub;
+	
+	if (textRows < 1) { textRows = 1; }
+	E.wrapTop += offset;
+	if (E.wrapTop > total - 1) { E.wrapTop = total - 1; }
+	if (E.wrapTop < 0) { E.wrapTop = 0; }
+	
+	cursorLine = editorWrapLinesBefore(visible) + editorWrapCursorSub(visible, col);
+	target = cursorLine;
+	if (cursorLine < E.wrapTop) { target = E.wrapTop; }
+	if (cursorLine >= E.wrapTop + textRows) { target = E.wrapTop + textRows - 1; }
+	
+	if (target != cursorLine) {
+		int row;
+		
+		visible = editorWrapVisibleAt(target, &sub);
+		row = editorVisibleToRow(visible);
+		col = sub * width + col % width;
+		if (row < E.numberOfRows && col > editorRowCols(&E.rows[row])) { col = editorRowCols(&E.rows[row]); }
+	}
+	editorWrapSetTop(visible);
+	editorSetCursorCol(col);
+}
+
+void editorToggleWrap () {
+	E.wrapActive = !E.wrapActive;
+	E.wrapTreeDirty = 1;
+	E.wrapYScroll = -1; //the top starts at the row that is at the top now
+	editorSetCursorCol(getCursorPositionInRenderdFileLine());
+	editorSetStatusMessage(E.wrapActive ? "Wrapping long lines" : "Not wrapping long lines");
+}
+
+/**** OUTPUTS ****/
+
+void editorSetStatusMessage (const char* fmt, ...) {
+	va_list ap;
+	va_start(ap, fmt);
+	vsnprintf(E.statusMsg, sizeof(E.statusMsg), fmt, ap);
+	va_end(ap);
+	E.statusMsgTime = time(NULL);
+	editorArmTimer(STATUS_MESSAGE_LIFE_TIME + 1); //the message is gone once more than the life time has passed
+}
+
+/*
+	draws the part of a row that fits on screen, starting from column startCol
+	this walks the rendered text, where tabs are already spaces so every byte is either
+	one column or part of a utf-8 charicter
+*/
+void editorDrawRow (struct abuf* buff, EditorRow* row, int startCol) {
+	int textCols = E.screenCols - LINE_START_SIZE; //compoensate for the start of the line e.g. line numbers
+	int maxCol = startCol + textCols;
+	int line = row - E.rows;
+	int currentColour = -1;
+	int selected = 0;
+	int selectStart, selectEnd; //the columns of the row that are selected
+	int render, col;
+	
+	if (!editorSelectionCols(line, &selectStart, &selectEnd)) { selectStart = selectEnd = -1; }
+	
+	if (row->longRow || row->hasGap) {
+		editorRowRenderWindow(row, startCol, textCols);
+		render = 0;
+		col = row->windowCol;
+	} else {
+		RowIndexEntry pos = editorRowPosFromCol(row, startCol);
+		render = pos.render;
+		col = pos.col;
+	}
+	
+	while (render < row->length) {
+		unsigned int cp;
+		int n = utf8Decode(&row->chars[render], row->length - render, &cp);
+		int width = (n > 1) ? codepointWidth(cp) : 1;
+		int color;
+		
+		if (n == 0) { n = 1; }
+		
+		if (col < startCol) { //a wide charicter cut by the left edge is drawn as spaces
+			int visible = col + width - startCol;
+			
+			while (visible-- > 0) { abufAppend(buff, " ", 1); }
+			render += n;
+			col += width;
+			continue;
+		}
+		if (col + width > maxCol) { break; }
+		
+		color = (row->hl[render] == HL_NORMAL) ? -1 : editorSyntaxToColor(row->hl[render]);
+		if (editorIsBracketMatch(line, col)) { color = editorSyntaxToColor(HL_BRACKET); }
+		if (color != currentColour) {
+			if (color == -1) {
+				abufAppend(buff, "\x1b[39m", 5);
+			} else {
+				char buf[16];
+				int clen = snprintf(buf, sizeof(buf), "\x1b[%dm", color);
+				abufAppend(buff, buf, clen);
+			}
+			currentColour = color;
+		}
+		if ((col >= selectStart && col < selectEnd) != selected) {
+			selected = !selected;
+			if (selected) { abufAppend(buff, "\x1b[7m", 4); }
+			else { abufAppend(buff, "\x1b[27m", 5); }
+		}
+		abufAppend(buff, &row->chars[render], n);
+		
+		render += n;
+		col += width;
+	}
+	
+	//a selected line break shows as one selected space past the end of the row
+	if (selectEnd == INT_MAX && render >= row->length && col >= startCol && col < maxCol) {
+		if (!selected) { abufAppend(buff, "\x1b[7m", 4); }
+		abufAppend(buff, " ", 1);
+		selected = 1;
+	}
+	if (selected) { abufAppend(buff, "\x1b[27m", 5); }
+	if (currentColour != -1) { abufAppend(buff, "\x1b[39m", 5); }
+}
+
+/*
+This is the function that is used to draw the editor row by row onto the screen!
+*/
+void editorDrawRows (struct abuf* buff) { 
+    int y;
+    int headerPadding;
+    char header[80];
+    int headerLen = snprintf(header, sizeof(header), HEADER_MESSAGE);
+
+	// this is drawing the header
+	{
+		int i = 0;
+		
+		if (headerLen > E.screenCols) { headerLen = E.screenCols; }
+		headerPadding = (E.screenCols - headerLen) / 2;
+		    
+		abufAppend(buff, "\x1b[K", 3); //clear lines as they are re-drawn
+		abufAppend(buff, "\x1b[7m", 4);
+		abufAppend(buff, "\x1b[1m", 4);
+		abufAppend(buff, "~", 1);
+		headerPadding--;
+		
+		i = headerPadding;
+		while (i--) { abufAppend(buff, " ", 1); }
+
+		abufAppend(buff, header, headerLen);
+		
+		i = headerPadding + 1;
+		while (i--) { abufAppend(buff, " ", 1); }
+		
+		abufAppend(buff, "\x1b[0m", 4);
+		abufAppend(buff, "\r\n", 2);
+    }
+    
+    int lineNumber = editorVisibleToRow(E.yScroll);
+    int sub = E.wrapActive ? E.wrapTop - editorWrapLinesBefore(E.yScroll) : 0; //when wrapping the top row can start part way down
+    for (y = 0; y < E.screenRows - HEADER_SIZE - 1; y++) { // this -1 is for the status bar at the bottom of the page 
+    	abufAppend(buff, "\x1b[K", 3); //clear lines as they are re-drawn
+  		  
+  		if (E.hexActive) {
+  			editorHexDrawLine(buff, y);
+  		} else if (lineNumber < E.numberOfRows) {    
+        	//a + at the start of the line shows rows are folded behind it, wrapped lines have nothing
+        	if (sub > 0) {
+        		abufAppend(buff, "  ", LINE_START_SIZE);
+        	} else {
+        		abufAppend(buff, (E.rows[lineNumber].foldedRows && !E.filterActive) ? "+ " : "~ ", LINE_START_SIZE);
+        	}
+            editorDrawRow(buff, &E.rows[lineNumber], E.wrapActive ? sub * editorWrapWidth() : E.xScroll);
+            
+            sub++;
+            if (!E.wrapActive || sub >= E.rows[lineNumber].wrapLines) {
+            	sub = 0;
+            	lineNumber = editorNextVisibleRow(lineNumber); //the next row that isnt folded or filtered away
+            }
+        } else {
+			abufAppend(buff, "~ ", LINE_START_SIZE);
+        }
+        
+        abufAppend(buff, "\r\n", 2);
+    }
+    
+    {
+		//drawing status bar
+		int tempStrLen;
+		int len;
+		
+		char tempStr[128];
+	
+		abufAppend(buff, "\x1b[K", 3); //clear lines as they are re-drawn
+		abufAppend(buff, "\x1b[7m", 4);
+		abufAppend(buff, "\x1b[1m", 4);
+		len = 0;
+		
+		abufAppend(buff, " FILE PATH: ", 12);
+		len += 12;
+		if (E.filePath) {
+			abufAppend(buff, E.filePath, E.filePathLength);
+			len += E.filePathLength;
+		} else if (E.searchQuery) {
+			tempStrLen = snprintf(tempStr, sizeof(tempStr), "[search: %.40s]", E.searchQuery);
+			abufAppend(buff, tempStr, tempStrLen);
+			len += tempStrLen;
+		} else {
+			abufAppend(buff, "[stdin]", 7);
+			len += 7;
+		}
+		
+		if (E.syntax) {
+			tempStrLen = snprintf(tempStr, sizeof(tempStr), " [%s]", E.syntax->name);
+			abufAppend(buff, tempStr, tempStrLen);
+			len += tempStrLen;
+		}
+		
+		if (E.ingestActive) {
+			abufAppend(buff, " (READING...)", 13);
+			len += 13;
+		}
+		
+		if (E.searchActive) {
+			abufAppend(buff, " (SEARCHING...)", 15);
+			len += 15;
+		}
+		
+		if (E.filterActive) {
+			tempStrLen = snprintf(tempStr, sizeof(tempStr), " FILTER: %d/%d", E.filterCount, E.numberOfRows);
+			abufAppend(buff, tempStr, tempStrLen);
+			len += tempStrLen;
+		}
+		
+		if (E.hexActive) {
+			tempStrLen = snprintf(tempStr, sizeof(tempStr), " OFFSET: 0x%zx/0x%zx%s", E.hexCursor, E.hexSize, E.hexWritable ? "" : " (READ ONLY)");
+		} else {
+			tempStrLen = snprintf(tempStr, sizeof(tempStr), " LINE NUMBER: %d/%d WORDS: %lld CHARS: %lld%s", getCurrentLineInFile(), E.numberOfRows,
+				E.wordTotal, E.charTotal, (E.wordNext < E.numberOfRows) ? " (COUNTING...)" : "");
+		}
+	  	abufAppend(buff, tempStr, tempStrLen);
+	  	len += tempStrLen;
+	  	
+	  	//not editorSetStatusMessage as that would set the timer going again
+	  	if (time(NULL) - E.statusMsgTime > STATUS_MESSAGE_LIFE_TIME) { snprintf(E.statusMsg, sizeof(E.statusMsg), "N/A"); }
+		
+		abufAppend(buff, " STATUS MESSAGE: ", 17);
+	  	len += 17;
+	  	tempStrLen = snprintf(tempStr, sizeof(tempStr), "%s", E.statusMsg);
+	  	abufAppend(buff, tempStr, tempStrLen);
+	  	len += tempStrLen;
+		
+		while (len < E.screenCols) {
+			abufAppend(buff, " ", 1);
+			len++;
+	  	}
+	 	abufAppend(buff, "\x1b[m", 3);
+	}
+}
+
+int getCurrentLine () {
+	return getCurrentLineInFile();
+}
+
+void editorRefreshScreen () {
+	char cbuff[32];
+
+    struct abuf buff = ABUF_INIT;
+    
+    editorSyncGapRow();
+    editorUpdateBracketMatch();
+    editorHexCheckSize();
+    if (E.hexActive) { editorHexScroll(); }
+    else if (E.wrapActive) { editorWrapScrollToCursor(); }
+
+    //hide cursor to stop flickering 
+    abufAppend(&buff, "\x1b[?25l", 6);
+    //puts curse in top left of screen
+    abufAppend(&buff, "\x1b[1;1H", 6);
+
+    editorDrawRows(&buff);
+    if (E.fuzzyActive) { editorFuzzyDrawPopup(&buff); }
+
+    //puts curse in correct location
+    
+    if (E.wrapActive && !E.hexActive) {
+    	snprintf(cbuff, sizeof(cbuff), "\x1b[%d;%dH", E.wrapCursorY + 1, E.wrapCursorX + 1);
+    } else {
+    	snprintf(cbuff, sizeof(cbuff), "\x1b[%d;%dH", E.cy + 1, E.cx + 1);
+    }
+    abufAppend(&buff, cbuff, strlen(cbuff));
+    
+    abufAppend(&buff, "\x1b[?25h", 6); //show cursor
+    
+    write(STDOUT_FILENO, buff.buffer, buff.length);
+    abufFree(&buff);
+}
+
+/**** FILE IO ****/
+/*
+#define MAX_LINE_LENGTH 150 //this is a masive overestimate so will need to be alterd at some point
+char* getNextLine (size_t* length, FILE* file) {
+ 
+}   
+*/
+
+//looks at the first bytes of the file to see if it is compressed, leaves the file offset alone
+int editorDetectCompression (int fd) {
+	unsigned char magic[4];
+	ssize_t nread = pread(fd, magic, sizeof(magic), 0);
+	
+	if (nread >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) { return COMPRESSION_GZIP; }
+	if (nread == 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) {
+		return COMPRESSION_ZSTD;
+	}
+	return COMPRESSION_NONE;
+}
+
+void editorOpen (char* filePath) {
+	int fd = open(filePath, O_RDONLY);
+	
+	if (fd == -1) { die("open"); }
+	editorOpenFd(filePath, fd);
+}
+
+//reads in a file that is already open, fd is owned after this
+void editorOpenFd (char* filePath, int fd) {
+	FILE *fp;
+	
+	char *line = NULL;
+	size_t lineCap = 0;
+	ssize_t lineLen = 0;
+	
+	free(E.filePath);
+	E.filePath = strdup(filePath);
+	E.filePathLength = strlen(E.filePath);
+	E.syntax = editorSelectSyntax(E.filePath);
+	
+	/*
+		compressed files are decoded chunk by chunk on a background thread straight into
+		the rows, the ui opens as soon as the first chunk is in
+	*/
+	E.fileCompression = editorDetectCompression(fd);
+#ifndef TOMS_ZSTD
+	//with no rows read in a save would write an empty file over it, so it is let go of
+	if (E.fileCompression == COMPRESSION_ZSTD) {
+		close(fd);
+		editorSetStatusMessage("%s is zstd, that isnt built in (make ZSTD=1)", filePath);
+		editorCloseFile();
+		return;
+	}
+#endif
+	editorWatchFile();
+	if (E.fileCompression != COMPRESSION_NONE) {
+		editorDiskRecord(NULL, 0);
+		editorIngestStart(fd, E.fileCompression);
+		return;
+	}
+	
+	//getline and the rows cant hold nul bytes, so a binary file is only ever shown as hex
+	if (editorHexSniff(fd)) {
+		close(fd);
+		if (editorHexOpen() == -1) {
+			//there are no rows to show instead, and saving them would empty the file, so it is let go of
+			editorSetStatusMessage("Could not map %s, it has nul bytes so it can only be shown as hex", filePath);
+			editorCloseFile();
+			return;
+		}
+		E.hexOnly = 1;
+		return;
+	}
+	
+	//a big file that was opened before has its rows made from the cached line offsets in the background
+	if (editorIndexCacheOpen(fd)) { return; }
+	
+	IndexBuilder index = {NULL, 0, 0};
+	uint64_t offset = 0;
+	int indexing = editorIndexCacheWanted(fd);
+	
+	fp = fdopen(fd, "r");
+	if (!fp) { die("fdopen"); }
+
+	lineLen = getline(&line, &lineCap, fp);
+
+	while (lineLen != -1) {
+		if (indexing) { editorIndexPush(&index, offset); }
+		offset += lineLen;
+		
+		while (lineLen > 0 && (line[lineLen - 1] == '\n' || line[lineLen - 1] == '\r')) {
+			lineLen--;
+		}
+			
+		editorInsertRow(E.numberOfRows, line, lineLen);	
+		lineLen = getline(&line, &lineCap, fp);
+	}
+	
+	if (indexing) {
+		editorIndexPush(&index, offset);
+		editorIndexCacheWrite(fd, &index);
+		free(index.offsets);
+	}
+	
+	free(line);
+	fclose(fp);
+	
+	int count;
+	SyncBlock* blocks = editorSyncRowBlocks(&count);
+	editorDiskRecord(blocks, count);
+}
+
+//write can stop part way through, so this keeps going till all of buf is out, -1 if a write fails
+int editorWriteAll (int fd, const char* buf, size_t len) {
+	size_t done = 0;
+	
+	while (done < len) {
+		ssize_t written = write(fd, &buf[done], len - done);
+		
+		if (written == -1) {
+			if (errno == EINTR) { continue; }
+			return -1;
+		}
+		done += written;
+	}
+	return 0;
+}
+
+/*
+	writes buf compressed the same way the file was when it was opened, it goes into a new file
+	next to the old one that is only renamed over it once it is all out, so a failed write or a
+	full disk leaves the old file as it was, errno says why it failed
+*/
+int editorWriteCompressed (char* buf, size_t len) {
+	char* temp = malloc(E.filePathLength + 8);
+	struct stat st;
+	int fd;
+	int ok = 0;
+	int saved;
+	
+	if (temp == NULL) { die("malloc"); }
+	sprintf(temp, "%s.XXXXXX", E.filePath);
+	fd = mkstemp(temp);
+	if (fd == -1) {
+		free(temp);
+		return -1;
+	}
+	//the new file gets the old ones permissions instead of the 0600 mkstemp gives it
+	fchmod(fd, (stat(E.filePath, &st) != -1) ? (st.st_mode & 07777) : 0644);
+	errno = EIO; //zlib doesnt always set errno when it fails
+	
+	if (E.fileCompression == COMPRESSION_GZIP) {
+		int gzFd = dup(fd); //gzclose closes the fd it was given, this one is kept to fsync
+		gzFile gz = (gzFd == -1) ? NULL : gzdopen(gzFd, "wb");
+		size_t done = 0;
+		
+		if (gz == NULL && gzFd != -1) { close(gzFd); }
+		ok = (gz != NULL);
+		//gzwrite takes an unsigned int so big files go in pieces
+		while (ok && done < len) {
+			unsigned int piece = (len - done > (1u << 30)) ? (1u << 30) : (unsigned int)(len - done);
+			
+			ok = gzwrite(gz, &buf[done], piece) == (int)piece;
+			done += piece;
+		}
+		if (gz != NULL && gzclose(gz) != Z_OK) { ok = 0; }
+	}
+	
+#ifdef TOMS_ZSTD
+	if (E.fileCompression == COMPRESSION_ZSTD) {
+		size_t bound = ZSTD_compressBound(len);
+		char* out = malloc(bound);
+		size_t outLen;
+		
+		if (out != NULL) {
+			outLen = ZSTD_compress(out, bound, buf, len, ZSTD_CLEVEL_DEFAULT);
+			ok = !ZSTD_isError(outLen) && editorWriteAll(fd, out, outLen) != -1;
+			free(out);
+		}
+	}
+#endif
+
+	if (ok && fsync(fd) == -1) { ok = 0; }
+	if (close(fd) == -1) { ok = 0; }
+	if (ok && rename(temp, E.filePath) == -1) { ok = 0; }
+	
+	saved = errno;
+	if (!ok) { unlink(temp); }
+	free(temp);
+	errno = saved;
+	return ok ? 0 : -1;
+}
+
+//caller should free return value
+char* editorRowsToString (size_t* bufLength) {
+	size_t totalLength = 0;
+	int i;
+	
+	for (i = 0; i < E.numberOfRows; i++) {
+		totalLength += E.rows[i].rawLength + 1; // "+ 1" is for the new line char	
+	}
+	
+	*bufLength = totalLength;
+	
+	char* buf = malloc(totalLength);
+	char* p = buf; // this is a pointer to where the next line will be added 
+	if (buf == NULL && totalLength > 0) { die("malloc"); }
+	for (i = 0; i < E.numberOfRows; i++) {
+		editorRowCopy(&E.rows[i], 0, E.rows[i].rawLength, p);
+		p += E.rows[i].rawLength;
+		*p = '\n';
+		p++;
+		
+	}
+		
+	return buf;
+}
+
+//returns 0 once the file is written, -1 if it wasnt and the status message says why
+int editorSave () {
+	int result = -1;
+	
+	//only part of the file is in the rows, saving now would write the rest of it away
+	if (E.ingestActive) {
+		editorSetStatusMessage("Still reading the file, save it once it is done");
+		return -1;
+	}
+	
+	if (E.filePath == NULL) {
+		E.filePath = editorPrompt("Save as: %s (ESC to leave)", NULL);
+		if (E.filePath == NULL) { return -1; }
+		E.filePathLength = strlen(E.filePath);
+		editorWatchFile();
+		editorSyntaxFromPath();
+	} else if (!E.diskConflict && editorDiskChanged()) {
+		//the first ctrl-s only warns, pressing it again saves over the other change
+		E.diskConflict = 1;
+		editorSetStatusMessage("File changed on disk! Ctrl-S again to overwrite, Ctrl-O to reload");
+		return -1;
+	}
+	
+	size_t len;
+	char *buf = editorRowsToString(&len);
+	
+	if (E.fileCompression != COMPRESSION_NONE) {
+		if (editorWriteCompressed(buf, len) != -1) {
+			editorSetStatusMessage("Saved file (compressed)");
+			E.fileModified = 0;
+			editorWatchFile(); //the file that was being watched has been renamed over
+			editorDiskRecord(NULL, 0);
+			result = 0;
+		} else {
+			editorSetStatusMessage("Cant save compressed file: %s", strerror(errno));
+		}
+		E.diskConflict = 0;
+		free(buf);
+		return result;
+	}
+	
+	/*
+	0644 is the standard permissions you usually want for text files. 
+	It gives the owner of the file permission to read and write the file, 
+	and everyone else only gets permission to read the file.
+	*/
+	int fd = open(E.filePath, O_RDWR | O_CREAT, 0644); 
+	
+	if (fd == -1) {
+		editorSetStatusMessage("Cant save: %s", strerror(errno));
+	} else if (ftruncate(fd, len) == -1) { //creates file to certain size
+		editorSetStatusMessage("Cant save: %s", strerror(errno));
+		close(fd);
+	} else if (editorWriteAll(fd, buf, len) == -1) {
+		editorSetStatusMessage("Cant save: %s", strerror(errno));
+		close(fd);
+	} else {
+		close(fd);
+		editorSetStatusMessage("Saved file");
+		E.fileModified = 0;
+		result = 0;
+		
+		int count;
+		SyncBlock* blocks = editorSyncTextBlocks(buf, len, &count);
+		editorDiskRecord(blocks, count);
+	}
+	
+	E.diskConflict = 0;
+	free(buf);
+	return result;
+}
+
+/**** DISK SYNC ****/
+/*
+	notices when something else changes the file, each block of rows has an xxh64 style hash
+	from when the file was opened or saved, a reload only splits the blocks that changed into
+	rows and leaves the rows before and after them alone
+*/
+
+#define HASH_PRIME1 0x9E3779B185EBCA87ULL
+#define HASH_PRIME2 0xC2B2AE3D27D4EB4FULL
+#define HASH_PRIME3 0x165667B19E3779F9ULL
+#define HASH_PRIME4 0x85EBCA77C2B2AE63ULL
+#define HASH_PRIME5 0x27D4EB2F165667C5ULL
+
+uint64_t hashRotl (uint64_t x, int r) {
+	return (x << r) | (x >> (64 - r));
+}
+
+uint64_t hashRead64 (const unsigned char* p) {
+	uint64_t v;
+	
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+uint64_t hashRound (uint64_t acc, uint64_t input) {
+	acc += input * HASH_PRIME2;
+	acc = hashRotl(acc, 31);
+	return acc * HASH_PRIME1;
+}
+
+uint64_t hashMerge (uint64_t acc, uint64_t lane) {
+	acc ^= hashRound(0, lane);
+	return acc * HASH_PRIME1 + HASH_PRIME4;
+}
+
+/*
+	xxh64, the four lanes dont depend on each other so the cpu runs them side by side
+	and it goes through memory about as fast as it can be read
+*/
+uint64_t editorHash (const void* data, size_t length, uint64_t seed) {
+	const unsigned char* p = data;
+	const unsigned char* end = p + length;
+	uint64_t h;
+	
+	if (length >= 32) {
+		uint64_t v1 = seed + HASH_PRIME1 + HASH_PRIME2;
+		uint64_t v2 = seed + HASH_PRIME2;
+		uint64_t v3 = seed;
+		uint64_t v4 = seed - HASH_PRIME1;
+		
+		do {
+			v1 = hashRound(v1, hashRead64(p));
+			v2 = hashRound(v2, hashRead64(p + 8));
+			v3 = hashRound(v3, hashRead64(p + 16));
+			v4 = hashRound(v4, hashRead64(p + 24));
+			p += 32;
+		} while (p + 32 <= end);
+		
+		h = hashRotl(v1, 1) + hashRotl(v2, 7) + hashRotl(v3, 12) + hashRotl(v4, 18);
+		h = hashMerge(h, v1);
+		h = hashMerge(h, v2);
+		h = hashMerge(h, v3);
+		h = hashMerge(h, v4);
+	} else {
+		h = seed + HASH_PRIME5;
+	}
+	h += length;
+	
+	while (p + 8 <= end) {
+		h ^= hashRound(0, hashRead64(p));
+		h = hashRotl(h, 27) * HASH_PRIME1 + HASH_PRIME4;
+		p += 8;
+	}
+	if (p + 4 <= end) {
+		uint32_t v;
+		
+		memcpy(&v, p, sizeof(v));
+		h ^= (uint64_t)v * HASH_PRIME1;
+		h = hashRotl(h, 23) * HASH_PRIME2 + HASH_PRIME3;
+		p += 4;
+	}
+	while (p < end) {
+		h ^= (*p++) * HASH_PRIME5;
+		h = hashRotl(h, 11) * HASH_PRIME1;
+	}
+	
+	h ^= h >> 33;
+	h *= HASH_PRIME2;
+	h ^= h >> 29;
+	h *= HASH_PRIME3;
+	h ^= h >> 32;
+	return h;
+}
+
+typedef struct SyncBuilder {
+	SyncBlock* blocks;
+	int count;
+	int capacity;
+	uint64_t rowHashes[SYNC_BLOCK_MAX]; //the hashes of the rows in the block being built
+	int rows;
+	off_t offset; //where the block being built starts
+} SyncBuilder;
+
+void editorSyncEndBlock (SyncBuilder* b) {
+	if (b->rows == 0) { return; }
+	
+	if (b->count == b->capacity) {
+		b->capacity = b->capacity ? b->capacity * 2 : 64;
+		b->blocks = realloc(b->blocks, sizeof(SyncBlock) * b->capacity);
+		if (b->blocks == NULL) { die("realloc"); }
+	}
+	b->blocks[b->count].hash   = editorHash(b->rowHashes, sizeof(uint64_t) * b->rows, 0);
+	b->blocks[b->count].rows   = b->rows;
+	b->blocks[b->count].offset = b->offset;
+	b->count++;
+	b->rows = 0;
+}
+
+//adds a row to the block being built, next is where the row after it starts in the file
+void editorSyncAddRow (SyncBuilder* b, const char* text, int length, off_t next) {
+	uint64_t hash = editorHash(text, length, 0);
+	
+	b->rowHashes[b->rows++] = hash;
+	if ((hash & SYNC_BLOCK_MASK) == SYNC_BLOCK_MASK || b->rows == SYNC_BLOCK_MAX) {
+		editorSyncEndBlock(b);
+		b->offset = next;
+	}
+}
+
+//splits text into rows the same way editorOpen does and hashes them into blocks
+SyncBlock* editorSyncTextBlocks (const char* text, size_t size, int* count) {
+	SyncBuilder* b = calloc(1, sizeof(SyncBuilder));
+	SyncBlock* blocks;
+	size_t pos = 0;
+	
+	if (b == NULL) { die("calloc"); }
+	while (pos < size) {
+		const char* newLine = memchr(&text[pos], '\n', size - pos);
+		size_t end = newLine ? (size_t)(newLine - text) : size;
+		size_t length = end - pos;
+		
+		while (length > 0 && (text[pos + length - 1] == '\r' || text[pos + length - 1] == '\n')) { length--; }
+		editorSyncAddRow(b, &text[pos], length, end + 1);
+		pos = end + 1;
+	}
+	editorSyncEndBlock(b);
+	
+	*count = b->count;
+	blocks = b->blocks;
+	free(b);
+	return blocks;
+}
+
+//the blocks for what is in the rows now
+SyncBlock* editorSyncRowBlocks (int* count) {
+	SyncBuilder* b = calloc(1, sizeof(SyncBuilder));
+	SyncBlock* blocks;
+	char* scratch = NULL;
+	int i;
+	
+	if (b == NULL) { die("calloc"); }
+	for (i = 0; i < E.numberOfRows; i++) {
+		EditorRow* row = &E.rows[i];
+		
+		editorSyncAddRow(b, editorRowRange(row, 0, row->rawLength, &scratch), row->rawLength, 0);
+	}
+	editorSyncEndBlock(b);
+	free(scratch);
+	
+	*count = b->count;
+	blocks = b->blocks;
+	free(b);
+	return blocks;
+}
+
+int editorSyncSameBlock (SyncBlock* a, SyncBlock* b) {
+	return a->hash == b->hash && a->rows == b->rows;
+}
+
+//maps the whole file read only, returns NULL if it cant, an empty file gives an empty string
+char* editorMapFile (const char* path, size_t* size) {
+	struct stat st;
+	char* text;
+	int fd = open(path, O_RDONLY);
+	
+	if (fd == -1) { return NULL; }
+	if (fstat(fd, &st) == -1) {
+		close(fd);
+		return NULL;
+	}
+	
+	*size = st.st_size;
+	if (*size == 0) {
+		close(fd);
+		return "";
+	}
+	text = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	return (text == MAP_FAILED) ? NULL : text;
+}
+
+void editorUnmapFile (char* text, size_t size) {
+	if (size > 0) { munmap(text, size); }
+}
+
+/*
+	(re)starts watching the file, needed again when it is replaced by renaming another file over it
+	plain writes are only looked at once they are closed so a half written file isnt read in
+*/
+void editorWatchFile () {
+	if (E.watchFd != -1) { inotify_rm_watch(E.inotifyFd, E.watchFd); }
+	E.watchFd = -1;
+	if (E.filePath) {
+		E.watchFd = inotify_add_watch(E.inotifyFd, E.filePath, IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF);
+	}
+}
+
+/*
+	remembers the file on disk as it is now, blocks is what it has in it and is owned after this
+	compressed files pass NULL and only their size and time are checked
+*/
+void editorDiskRecord (SyncBlock* blocks, int count) {
+	struct stat st;
+	
+	free(E.diskBlocks);
+	E.diskBlocks = blocks;
+	E.diskBlockCount = count;
+	E.diskSize = -1;
+	if (E.filePath && stat(E.filePath, &st) != -1) {
+		E.diskSize  = st.st_size;
+		E.diskMtime = st.st_mtim;
+	}
+}
+
+//returns 1 if the file on disk isnt what was last opened or saved, a file that was only touched doesnt count
+int editorDiskChanged () {
+	struct stat st;
+	SyncBlock* blocks;
+	size_t size;
+	char* text;
+	int count, i;
+	int same;
+	
+	if (E.filePath == NULL || E.diskSize < 0) { return 0; }
+	if (stat(E.filePath, &st) == -1) { return 0; }
+	if (st.st_size == E.diskSize && st.st_mtim.tv_sec == E.diskMtime.tv_sec && st.st_mtim.tv_nsec == E.diskMtime.tv_nsec) {
+		return 0;
+	}
+	if (E.diskBlocks == NULL) { return 1; }
+	
+	if ((text = editorMapFile(E.filePath, &size)) == NULL) { return 0; }
+	blocks = editorSyncTextBlocks(text, size, &count);
+	editorUnmapFile(text, size);
+	
+	same = (count == E.diskBlockCount);
+	for (i = 0; same && i < count; i++) { same = editorSyncSameBlock(&blocks[i], &E.diskBlocks[i]); }
+	free(blocks);
+	
+	if (same) {
+		E.diskSize  = st.st_size;
+		E.diskMtime = st.st_mtim;
+	}
+	return !same;
+}
+
+//compressed files cant be split up where they changed so they are read in again from the start
+void editorReloadFully () {
+	char* path;
+	
+	editorDelRows(0, E.numberOfRows);
+	editorUndoClear();
+	
+	path = strdup(E.filePath);
+	editorOpen(path);
+	free(path);
+	
+	E.cy = HEADER_SIZE;
+	E.yScroll = 0;
+	editorSetCursorCol(0);
+	E.fileModified = 0;
+	E.diskConflict = 0;
+}
+
+//drops the rows and everything about the open file so another one can be opened
+void editorCloseFile () {
+	if (E.hexActive) { editorHexClose(); }
+	E.hexOnly = 0;
+	editorFilterClear();
+	editorDelRows(0, E.numberOfRows);
+	editorUndoClear();
+	
+	free(E.filePath);
+	free(E.searchQuery);
+	E.filePath = NULL;
+	E.filePathLength = 0;
+	E.searchQuery = NULL;
+	E.syntax = NULL;
+	E.fileCompression = COMPRESSION_NONE;
+	editorWatchFile(); //with no path this just stops watching
+	editorDiskRecord(NULL, 0);
+	
+	E.cy = HEADER_SIZE;
+	E.yScroll = 0;
+	editorSetCursorCol(0);
+	E.fileModified = 0;
+	E.diskConflict = 0;
+}
+
+/*
+	opens another file in place of this one, a directory search still going is stopped first
+	the new file is opened before this one is closed, so if it cant be read or isnt a plain file
+	this one stays and -1 is returned with the status message saying why
+*/
+int editorSwitchFile (char* path) {
+	struct stat st;
+	int fd = open(path, O_RDONLY | O_NONBLOCK); //a fifo would wait for a writer with the rows locked
+	
+	if (fd == -1) {
+		editorSetStatusMessage("Cant open %s: %s", path, strerror(errno));
+		return -1;
+	}
+	if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode)) {
+		editorSetStatusMessage("Cant open %s: it isnt a plain file", path);
+		close(fd);
+		return -1;
+	}
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+	
+	__atomic_add_fetch(&E.searchGeneration, 1, __ATOMIC_RELAXED);
+	E.searchActive = 0;
+	editorCloseFile();
+	editorOpenFd(path, fd);
+	return 0;
+}
+
+//splits the text of one new block into rows and puts them in at row, returns how many it put in
+//the rows are counted first so a run of new blocks goes in with one move of the rows after it
+int editorReloadInsertBlock (char* text, size_t pos, size_t end, int row) {
+	int rows = 0;
+	int k;
+	size_t at;
+	
+	for (at = pos; at < end; rows++) {
+		char* newLine = memchr(&text[at], '\n', end - at);
+		
+		at = newLine ? (size_t)(newLine - text) + 1 : end;
+	}
+	if (rows == 0) { return 0; }
+	
+	editorInsertRows(row, rows);
+	for (k = 0; k < rows; k++) {
+		char* newLine = memchr(&text[pos], '\n', end - pos);
+		size_t lineEnd = newLine ? (size_t)(newLine - text) : end;
+		size_t length = lineEnd - pos;
+		char* line;
+		
+		while (length > 0 && (text[pos + length - 1] == '\r' || text[pos + length - 1] == '\n')) { length--; }
+		line = malloc(length + 1);
+		if (line == NULL) { die("malloc"); }
+		memcpy(line, &text[pos], length);
+		editorRowGiveText(&E.rows[row + k], line, length);
+		pos = lineEnd + 1;
+	}
+	editorUndoInsertedRows(row, rows);
+	return rows;
+}
+
+//where an old block is in the new ones at or after from, -1 if it isnt
+int editorReloadFindBlock (SyncBlock* block, SyncBlock* newBlocks, int* table, int tableMask, int from) {
+	int k = block->hash & tableMask;
+	
+	while (table[k] && newBlocks[table[k] - 1].hash != block->hash) { k = (k + 1) & tableMask; }
+	if (table[k] && table[k] - 1 >= from && newBlocks[table[k] - 1].rows == block->rows) { return table[k] - 1; }
+	return -1;
+}
+
+/*
+	reads the file in again, the old and new blocks are walked together and a block that is
+	in both is kept, the rest are deleted or split into rows, a run of blocks next to each other
+	goes out or in with one move of the rows after it, the whole reload is one undo
+*/
+void editorReload () {
+	SyncBlock* oldBlocks;
+	SyncBlock* newBlocks;
+	int oldCount, newCount;
+	int* table; //new block index + 1 by hash, so old blocks can find where they went
+	int tableMask = 1;
+	int row = 0;
+	int oldRows = 0;
+	int newRows = 0;
+	int line = getCurrentLineInFile();
+	int lineGone = 0; //the cursor row was deleted so it goes to the start of what replaces it
+	int col = getCursorPositionInRenderdFileLine();
+	size_t size;
+	char* text;
+	int i, j, k;
+	
+	if (E.filePath == NULL) { return; }
+	if (E.ingestActive) {
+		editorSetStatusMessage("Still reading the file, reload it once it is done");
+		return;
+	}
+	if (E.fileCompression != COMPRESSION_NONE) {
+		editorReloadFully();
+		return;
+	}
+	if ((text = editorMapFile(E.filePath, &size)) == NULL) {
+		editorSetStatusMessage("Could not read %s", E.filePath);
+		return;
+	}
+	
+	newBlocks = editorSyncTextBlocks(text, size, &newCount);
+	//the blocks from the last open or save are what is in the rows unless they have been changed
+	if (E.fileModified || E.diskBlocks == NULL) {
+		oldBlocks = editorSyncRowBlocks(&oldCount);
+	} else {
+		oldBlocks = E.diskBlocks;
+		oldCount = E.diskBlockCount;
+		E.diskBlocks = NULL;
+	}
+	
+	while (tableMask < newCount * 2) { tableMask <<= 1; }
+	table = calloc(tableMask, sizeof(int));
+	if (table == NULL) { die("calloc"); }
+	tableMask--;
+	//filled from the back so a repeated block finds its first place
+	for (j = newCount - 1; j >= 0; j--) {
+		k = newBlocks[j].hash & tableMask;
+		while (table[k] && newBlocks[table[k] - 1].hash != newBlocks[j].hash) { k = (k + 1) & tableMask; }
+		table[k] = j + 1;
+	}
+	
+	editorUndoBegin(UNDO_EDIT, -1);
+	i = 0;
+	j = 0;
+	while (i < oldCount || j < newCount) {
+		int found = -1;
+		
+		if (i < oldCount && j < newCount && editorSyncSameBlock(&oldBlocks[i], &newBlocks[j])) {
+			row += oldBlocks[i++].rows;
+			j++;
+			lineGone = 0;
+			continue;
+		}
+		if (i < oldCount) { found = editorReloadFindBlock(&oldBlocks[i], newBlocks, table, tableMask, j); }
+		
+		if (i < oldCount && found == -1) {
+			//the old block is gone, and so are the ones after it up to one that is kept
+			int gone = 0;
+			
+			do {
+				gone += oldBlocks[i++].rows;
+			} while (i < oldCount && !(j < newCount && editorSyncSameBlock(&oldBlocks[i], &newBlocks[j]))
+			         && editorReloadFindBlock(&oldBlocks[i], newBlocks, table, tableMask, j) == -1);
+			
+			if (gone > 0) {
+				editorUndoDeletedRows(row, gone);
+				editorDelRows(row, gone);
+			}
+			if (line >= row + gone) { line -= gone; }
+			else if (line >= row) {
+				line = row;
+				lineGone = 1;
+			}
+			oldRows += gone;
+		} else {
+			//new blocks come before the next old one that is kept, or after the last one
+			int end = (found == -1) ? newCount : found;
+			size_t stop = (end < newCount) ? (size_t)newBlocks[end].offset : size;
+			int rows = (j < end) ? editorReloadInsertBlock(text, newBlocks[j].offset, stop, row) : 0;
+			
+			if (line > row || (line == row && !lineGone)) { line += rows; }
+			row += rows;
+			newRows += rows;
+			j = end;
+		}
+	}
+	free(table);
+	free(oldBlocks);
+	editorUnmapFile(text, size);
+	editorDiskRecord(newBlocks, newCount);
+	
+	if (line >= E.numberOfRows) { line = E.numberOfRows - 1; }
+	if (line < 0) { line = 0; }
+	editorGoToLine(line, col);
+	editorClampCursor();
+	
+	E.fileModified = 0;
+	E.diskConflict = 0;
+	editorSetStatusMessage("Reloaded from disk, %d lines replaced with %d", oldRows, newRows);
+}
+
+//the file has had something done to it, reload it if there is nothing to lose or warn if there is
+void editorDiskEvent () {
+	uint64_t buf[512]; //inotify events need lining up like this
+	ssize_t n;
+	int rewatch = 0;
+	
+	while ((n = read(E.inotifyFd, buf, sizeof(buf))) > 0) {
+		char* p = (char*)buf;
+		
+		while (p < (char*)buf + n) {
+			struct inotify_event* ev = (struct inotify_event*)p;
+			
+			if (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) { rewatch = 1; }
+			p += sizeof(struct inotify_event) + ev->len;
+		}
+	}
+	if (rewatch) { editorWatchFile(); }
+	editorHexCheckSize();
+	
+	if (!editorDiskChanged()) { return; }
+	if (E.fileModified == 0) {
+		editorReload();
+	} else {
+		editorSetStatusMessage("File changed on disk! Ctrl-O reloads it, Ctrl-S overwrites it");
+	}
+}
+
+/**** STREAMING ****/
+/*
+	lets the document be read from a pipe e.g. "some_command | editor"
+	a reader thread pulls chunks off the pipe and turns them into rows while the ui keeps
+	running, the keys are read from /dev/tty instead of the pipe
+*/
+
+typedef struct IngestState {
+	int fd;
+	char* partial; //a line that was started in the last chunk but not finished
+	size_t partialLength;
+	size_t partialCap;
+	
+	//compressed input is decoded into out one chunk at a time, so there is never a full copy
+	int compression;
+	char* out;
+	z_stream zs;
+#ifdef TOMS_ZSTD
+	ZSTD_DStream* zds;
+#endif
+} IngestState;
+
+void editorLockRows () {
+	pthread_mutex_lock(&E.rowsLock);
+}
+
+void editorUnlockRows () {
+	pthread_mutex_unlock(&E.rowsLock);
+}
+
+//called from any thread to get the ui to redraw the screen
+void editorRequestRedraw () {
+	uint64_t one = 1;
+	
+	write(E.wakeFd, &one, sizeof(one)); //if the counter is full a redraw is already waiting
+}
+
+//adds a finished line to the end of the rows, caller must hold the rows lock
+void editorIngestLine (char* line, size_t length) {
+	int keep;
+	
+	while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) {
+		length--;
+	}
+	//the line is looked at before it is a row, so a long one doesnt have to be searched chunk by chunk
+	keep = !E.filterActive || editorFindInText(line, length, E.filterQuery, strlen(E.filterQuery)) != -1;
+	editorInsertRow(E.numberOfRows, line, length);
+	
+	//new rows are always shown when filtering, but ones that are read in are only kept if they match
+	if (!keep) { editorFilterRemoveRow(E.numberOfRows - 1); }
+}
+
+void editorIngestKeepPartial (IngestState* ingest, char* data, size_t length) {
+	if (ingest->partialLength + length > ingest->partialCap) {
+		ingest->partialCap = (ingest->partialLength + length) * 2;
+		ingest->partial = realloc(ingest->partial, ingest->partialCap);
+		if (ingest->partial == NULL) { die("realloc"); }
+	}
+	memcpy(&ingest->partial[ingest->partialLength], data, length);
+	ingest->partialLength += length;
+}
+
+//splits a chunk into rows, anything after the last new line is kept for the next chunk
+void editorIngestAppend (IngestState* ingest, char* data, size_t length) {
+	char* end = data + length;
+	
+	while (data < end) {
+		char* newLine = memchr(data, '\n', end - data);
+		
+		if (newLine == NULL) {
+			editorIngestKeepPartial(ingest, data, end - data);
+			return;
+		}
+		
+		if (ingest->partialLength) {
+			editorIngestKeepPartial(ingest, data, newLine - data);
+			editorIngestLine(ingest->partial, ingest->partialLength);
+			ingest->partialLength = 0;
+		} else {
+			editorIngestLine(data, newLine - data);
+		}
+		data = newLine + 1;
+	}
+}
+
+//adds a chunk of decoded text to the rows and lets the ui know about it
+void editorIngestChunk (IngestState* ingest, char* data, size_t length) {
+	//the chunk was read without the lock so the ui only waits for the split
+	editorLockRows();
+	editorIngestAppend(ingest, data, length);
+	editorUnlockRows();
+	editorRequestRedraw();
+}
+
+//returns -1 if the compressed data is broken
+int editorIngestGzip (IngestState* ingest, char* data, size_t length) {
+	z_stream* zs = &ingest->zs;
+	int result;
+	
+	zs->next_in  = (unsigned char*)data;
+	zs->avail_in = length;
+	
+	while (zs->avail_in > 0) {
+		zs->next_out  = (unsigned char*)ingest->out;
+		zs->avail_out = INGEST_CHUNK_SIZE;
+		
+		result = inflate(zs, Z_NO_FLUSH);
+		if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR) { return -1; }
+		
+		if (zs->avail_out != INGEST_CHUNK_SIZE) {
+			editorIngestChunk(ingest, ingest->out, INGEST_CHUNK_SIZE - zs->avail_out);
+		}
+		
+		//rotated logs are often several gzip members stuck together
+		if (result == Z_STREAM_END && inflateReset(zs) != Z_OK) { return -1; }
+		if (result == Z_BUF_ERROR && zs->avail_out != 0) { break; }
+	}
+	return 0;
+}
+
+#ifdef TOMS_ZSTD
+int editorIngestZstd (IngestState* ingest, char* data, size_t length) {
+	ZSTD_inBuffer in = { data, length, 0 };
+	
+	while (in.pos < in.size) {
+		ZSTD_outBuffer out = { ingest->out, INGEST_CHUNK_SIZE, 0 };
+		size_t result = ZSTD_decompressStream(ingest->zds, &out, &in);
+		
+		if (ZSTD_isError(result)) { return -1; }
+		if (out.pos) { editorIngestChunk(ingest, ingest->out, out.pos); }
+	}
+	
+	//flush anything zstd is still holding on to
+	while (1) {
+		ZSTD_outBuffer out = { ingest->out, INGEST_CHUNK_SIZE, 0 };
+		size_t result = ZSTD_decompressStream(ingest->zds, &out, &in);
+		
+		if (ZSTD_isError(result)) { return -1; }
+		if (out.pos) { editorIngestChunk(ingest, ingest->out, out.pos); }
+		if (out.pos < out.size) { break; }
+	}
+	return 0;
+}
+#endif
+
+int editorIngestDecode (IngestState* ingest, char* data, size_t length) {
+	switch (ingest->compression) {
+		case COMPRESSION_GZIP: return editorIngestGzip(ingest, data, length);
+#ifdef TOMS_ZSTD
+		case COMPRESSION_ZSTD: return editorIngestZstd(ingest, data, length);
+#endif
+		default:
+			editorIngestChunk(ingest, data, length);
+			return 0;
+	}
+}
+
+void* editorIngestThread (void* arg) {
+	IngestState* ingest = arg;
+	char* chunk = malloc(INGEST_CHUNK_SIZE);
+	ssize_t nread;
+	int broken = 0;
+	
+	if (chunk == NULL) { die("malloc"); }
+	
+	while ((nread = read(ingest->fd, chunk, INGEST_CHUNK_SIZE)) != 0) {
+		if (nread == -1) {
+			if (errno == EINTR) { continue; }
+			break;
+		}
+		
+		if (editorIngestDecode(ingest, chunk, nread) == -1) {
+			broken = 1;
+			break;
+		}
+	}
+	
+	editorLockRows();
+	if (ingest->partialLength) { editorIngestLine(ingest->partial, ingest->partialLength); }
+	if (broken) {
+		editorSetStatusMessage("Compressed data is corrupt, stopped after %d lines", E.numberOfRows);
+	} else if (nread == -1) {
+		editorSetStatusMessage("Read error: %s", strerror(errno));
+	} else {
+		editorSetStatusMessage("Finished reading %d lines", E.numberOfRows);
+	}
+	E.ingestActive = 0;
+	editorUnlockRows();
+	editorRequestRedraw();
+	
+	if (ingest->compression == COMPRESSION_GZIP) { inflateEnd(&ingest->zs); }
+#ifdef TOMS_ZSTD
+	if (ingest->compression == COMPRESSION_ZSTD) { ZSTD_freeDStream(ingest->zds); }
+#endif
+	close(ingest->fd);
+	free(ingest->partial);
+	free(ingest->out);
+	free(ingest);
+	free(chunk);
+	return NULL;
+}
+
+//starts reading rows from fd in the background, caller must hold the rows lock
+void editorIngestStart (int fd, int compression) {
+	pthread_t thread;
+	IngestState* ingest = calloc(1, sizeof(IngestState));
+	
+	if (ingest == NULL) { die("calloc"); }
+	ingest->fd = fd;
+	ingest->compression = compression;
+	
+	if (compression == COMPRESSION_GZIP) {
+		//15 + 32 lets zlib take both gzip and zlib headers
+		if (inflateInit2(&ingest->zs, 15 + 32) != Z_OK) { die("inflateInit2"); }
+	} else if (compression == COMPRESSION_ZSTD) {
+#ifdef TOMS_ZSTD
+		ingest->zds = ZSTD_createDStream();
+		if (ingest->zds == NULL) { die("ZSTD_createDStream"); }
+		ZSTD_initDStream(ingest->zds);
+#else
+		editorSetStatusMessage("zstd support not built in (make ZSTD=1)");
+		close(fd);
+		free(ingest);
+		return;
+#endif
+	}
+	
+	if (compression != COMPRESSION_NONE) {
+		ingest->out = malloc(INGEST_CHUNK_SIZE);
+		if (ingest->out == NULL) { die("malloc"); }
+	}
+	E.ingestActive = 1;
+	
+	if (pthread_create(&thread, NULL, editorIngestThread, ingest) != 0) { die("pthread_create"); }
+	pthread_detach(thread);
+}
+
+/**** INDEX CACHE ****/
+/*
+	a big file keeps where each of its lines starts in ~/.cache/toms-editor so the next open
+	doesnt have to look for the new lines, the cache is found by the files real path and is only
+	used if the size, the modified time and a hash of pieces spread through the file all match
+	the offsets are checked as the rows are made from them, one byte a row, and if one is wrong
+	the rest of the file is split the normal way and the cache is thrown out
+
+	the cache file is a header followed by lines + 1 offsets, all 8 bytes so it is used straight
+	out of a mapping, offsets[lines] is the size of the file
+*/
+
+typedef struct IndexCacheHeader {
+	char magic[8];
+	uint64_t size;
+	int64_t mtimeSec;
+	int64_t mtimeNsec;
+	uint64_t sample;
+	uint64_t lines;
+} IndexCacheHeader;
+
+typedef struct IndexIngest {
+	char* text; //the file mapped
+	size_t size;
+	char* cache; //the cache mapped
+	size_t cacheSize;
+	const uint64_t* offsets;
+	uint64_t lines;
+	uint64_t next; //the next line to be made into a row
+	int broken; //an offset didnt match the file
+	int shrunk; //something cut the file down while it was read, the mapping past the new end cant be touched
+	int fd; //kept open to check the size between batches
+	char path[PATH_MAX];
+} IndexIngest;
+
+#define INDEX_CACHE_MAGIC "TOMSIDX1"
+
+//where the cache for the open file goes, returns -1 if there is nowhere to put it
+int editorIndexCachePath (char* path, int makeDir) {
+	char real[PATH_MAX];
+	char dir[PATH_MAX - 32]; //room left for the file name
+	const char* base = getenv("XDG_CACHE_HOME");
+	
+	if (E.filePath == NULL || realpath(E.filePath, real) == NULL) { return -1; }
+	if (base && base[0]) {
+		snprintf(dir, sizeof(dir), "%s/toms-editor", base);
+	} else if ((base = getenv("HOME")) && base[0]) {
+		snprintf(dir, sizeof(dir), "%s/.cache", base);
+		if (makeDir) { mkdir(dir, 0700); }
+		snprintf(dir, sizeof(dir), "%s/.cache/toms-editor", base);
+	} else {
+		return -1;
+	}
+	if (makeDir) { mkdir(dir, 0700); }
+	
+	snprintf(path, PATH_MAX, "%s/%016llx.idx", dir, (unsigned long long)editorHash(real, strlen(real), 0));
+	return 0;
+}
+
+//a hash of a few pieces spread through the file, quick to work out even for a huge file
+uint64_t editorIndexSample (int fd, uint64_t size) {
+	char buf[INDEX_CACHE_SAMPLE_SIZE];
+	uint64_t hash = size;
+	int i;
+	
+	for (i = 0; i < INDEX_CACHE_SAMPLES; i++) {
+		uint64_t at = (size > INDEX_CACHE_SAMPLE_SIZE) ? (size - INDEX_CACHE_SAMPLE_SIZE) * i / (INDEX_CACHE_SAMPLES - 1) : 0;
+		ssize_t nread = pread(fd, buf, sizeof(buf), at);
+		
+		if (nread > 0) { hash = editorHash(buf, nread, hash); }
+	}
+	return hash;
+}
+
+int editorIndexCacheWanted (int fd) {
+	struct stat st;
+	
+	return fstat(fd, &st) != -1 && S_ISREG(st.st_mode) && st.st_size >= INDEX_CACHE_MIN_SIZE;
+}
+
+void editorIndexPush (IndexBuilder* index, uint64_t offset) {
+	if (index->count == index->capacity) {
+		index->capacity = index->capacity ? index->capacity * 2 : 4096;
+		index->offsets = realloc(index->offsets, sizeof(uint64_t) * index->capacity);
+		if (index->offsets == NULL) { die("realloc"); }
+	}
+	index->offsets[index->count++] = offset;
+}
+
+//writes to a temporary file and renames it so a half written cache is never read
+void editorIndexCacheWrite (int fd, IndexBuilder* index) {
+	IndexCacheHeader header;
+	struct stat st;
+	char path[PATH_MAX];
+	char temp[PATH_MAX + 32];
+	int out;
+	int ok;
+	
+	if (fstat(fd, &st) == -1 || (uint64_t)st.st_size != index->offsets[index->count - 1]) { return; } //changed while it was read
+	if (editorIndexCachePath(path, 1) == -1) { return; }
+	
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, INDEX_CACHE_MAGIC, sizeof(header.magic));
+	header.size = st.st_size;
+	header.mtimeSec = st.st_mtim.tv_sec;
+	header.mtimeNsec = st.st_mtim.tv_nsec;
+	header.sample = editorIndexSample(fd, st.st_size);
+	header.lines = index->count - 1;
+	
+	snprintf(temp, sizeof(temp), "%s.%d", path, (int)getpid());
+	if ((out = open(temp, O_WRONLY | O_CREAT | O_TRUNC, 0600)) == -1) { return; }
+	ok = write(out, &header, sizeof(header)) == sizeof(header)
+	     && write(out, index->offsets, sizeof(uint64_t) * index->count) == (ssize_t)(sizeof(uint64_t) * index->count);
+	close(out);
+	
+	if (!ok || rename(temp, path) == -1) { unlink(temp); }
+}
+
+/*
+	makes rows from the offsets until count more have been made, the byte before the next
+	line has to be a new line or the cache isnt for this file, caller must hold the rows lock
+*/
+void editorIndexAddRows (IndexIngest* index, uint64_t count) {
+	uint64_t end = index->next + count;
+	
+	if (end > index->lines) { end = index->lines; }
+	for (; index->next < end; index->next++) {
+		uint64_t start = index->offsets[index->next];
+		uint64_t stop = index->offsets[index->next + 1];
+		
+		if (stop <= start || stop > index->size || (index->next + 1 < index->lines && index->text[stop - 1] != '\n')) {
+			index->broken = 1;
+			return;
+		}
+		editorIngestLine(&index->text[start], stop - start);
+	}
+}
+
+//splits count more rows out of the file the slow way, for once the cache turned out wrong
+void editorIndexSplitRows (IndexIngest* index, size_t* pos, uint64_t count) {
+	while (*pos < index->size && count--) {
+		char* newLine = memchr(&index->text[*pos], '\n', index->size - *pos);
+		size_t end = newLine ? (size_t)(newLine - index->text) : index->size;
+		
+		editorIngestLine(&index->text[*pos], end - *pos);
+		*pos = end + 1;
+	}
+}
+
+/*
+	reading a page of the mapping that is past the end of the file kills the editor with SIGBUS,
+	so the size is checked before each batch and the reading stops if the file got smaller
+*/
+int editorIndexFileShrank (IndexIngest* index) {
+	struct stat st;
+	
+	if (!index->shrunk && (fstat(index->fd, &st) == -1 || (size_t)st.st_size < index->size)) { index->shrunk = 1; }
+	return index->shrunk;
+}
+
+void* editorIndexIngestThread (void* arg) {
+	IndexIngest* index = arg;
+	size_t pos = 0;
+	SyncBlock* blocks = NULL;
+	int count = 0;
+	
+	while (index->next < index->lines && !index->broken && !editorIndexFileShrank(index)) {
+		editorLockRows();
+		editorIndexAddRows(index, INDEX_INGEST_BATCH);
+		editorUnlockRows();
+		editorRequestRedraw();
+	}
+	
+	if (index->broken && !index->shrunk) {
+		//every row before the broken one was checked, so the rest carries on from there
+		pos = index->offsets[index->next];
+		unlink(index->path);
+		while (pos < index->size && !editorIndexFileShrank(index)) {
+			editorLockRows();
+			editorIndexSplitRows(index, &pos, INDEX_INGEST_BATCH);
+			editorUnlockRows();
+			editorRequestRedraw();
+		}
+	}
+	
+	if (!editorIndexFileShrank(index)) { blocks = editorSyncTextBlocks(index->text, index->size, &count); }
+	
+	editorLockRows();
+	editorDiskRecord(blocks, count);
+	if (index->shrunk) {
+		editorSetStatusMessage("The file got smaller while it was read, only %d lines were read", E.numberOfRows);
+	} else {
+		editorSetStatusMessage("Finished reading %d lines%s", E.numberOfRows, index->broken ? ", the index cache was out of date" : " from the index cache");
+	}
+	E.ingestActive = 0;
+	editorUnlockRows();
+	editorRequestRedraw();
+	
+	editorUnmapFile(index->text, index->size);
+	editorUnmapFile(index->cache, index->cacheSize);
+	close(index->fd);
+	free(index);
+	return NULL;
+}
+
+/*
+	if the file has a cache that matches it, the first screen of rows is made straight away
+	and the rest are made on a background thread, returns 0 if there isnt a cache to use
+	caller must hold the rows lock
+*/
+int editorIndexCacheOpen (int fd) {
+	IndexIngest* index;
+	const IndexCacheHeader* header;
+	struct stat st;
+	pthread_t thread;
+	
+	if (!editorIndexCacheWanted(fd) || fstat(fd, &st) == -1) { return 0; }
+	if ((index = calloc(1, sizeof(IndexIngest))) == NULL) { die("calloc"); }
+	if (editorIndexCachePath(index->path, 0) == -1 || (index->cache = editorMapFile(index->path, &index->cacheSize)) == NULL) {
+		free(index);
+		return 0;
+	}
+	
+	header = (const IndexCacheHeader*)index->cache;
+	if (index->cacheSize < sizeof(IndexCacheHeader)
+	    || memcmp(header->magic, INDEX_CACHE_MAGIC, sizeof(header->magic)) != 0
+	    || header->size != (uint64_t)st.st_size
+	    || header->mtimeSec != st.st_mtim.tv_sec || header->mtimeNsec != st.st_mtim.tv_nsec
+	    || index->cacheSize != sizeof(IndexCacheHeader) + sizeof(uint64_t) * (header->lines + 1)
+	    || header->sample != editorIndexSample(fd, st.st_size)) {
+		editorUnmapFile(index->cache, index->cacheSize);
+		free(index);
+		return 0;
+	}
+	
+	index->offsets = (const uint64_t*)(index->cache + sizeof(IndexCacheHeader));
+	index->lines = header->lines;
+	if (index->offsets[0] != 0 || index->offsets[index->lines] != (uint64_t)st.st_size
+	    || (index->text = editorMapFile(E.filePath, &index->size)) == NULL || index->size != (size_t)st.st_size) {
+		if (index->text) { editorUnmapFile(index->text, index->size); }
+		editorUnmapFile(index->cache, index->cacheSize);
+		free(index);
+		return 0;
+	}
+	index->fd = fd; //the thread closes it once it is done
+	
+	//the number of rows is known so they are allocated once
+	if ((uint64_t)E.rowsCapacity < index->lines && index->lines < INT_MAX) {
+		E.rows = realloc(E.rows, sizeof(EditorRow) * index->lines);
+		if (E.rows == NULL) { die("realloc"); }
+		E.rowsCapacity = index->lines;
+	}
+	
+	editorIndexAddRows(index, E.screenRows);
+	E.ingestActive = 1;
+	if (pthread_create(&thread, NULL, editorIndexIngestThread, index) != 0) { die("pthread_create"); }
+	pthread_detach(thread);
+	return 1;
+}
+
+/*
+	when stdin is a pipe the pipe is moved to a new fd and the terminal is put on stdin,
+	this way all the code that reads keys from STDIN_FILENO keeps working
+	returns the fd of the pipe
+*/
+int editorReattachTerminal () {
+	int streamFd = dup(STDIN_FILENO);
+	int tty = open("/dev/tty", O_RDWR);
+	
+	if (streamFd == -1 || tty == -1) { die("open /dev/tty"); }
+	if (dup2(tty, STDIN_FILENO) == -1) { die("dup2"); }
+	close(tty);
+	
+	return streamFd;
+}
+
+/**** PARALLEL ****/
+/*
+	splits a pass over the rows between a few threads, the ui thread keeps the rows lock the
+	whole time and does one of the ranges itself, so the workers can only read the rows
+*/
+
+typedef struct ParallelJob {
+	int start; //the range of items this thread does
+	int end;
+	int thread;
+	void* arg;
+	void (*work)(struct ParallelJob*);
+} ParallelJob;
+
+int editorThreadCount () {
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	
+	if (count < 1) { count = 1; }
+	if (count > PARALLEL_MAX_THREADS) { count = PARALLEL_MAX_THREADS; }
+	return count;
+}
+
+void* editorParallelThread (void* arg) {
+	ParallelJob* job = arg;
+	
+	job->work(job);
+	return NULL;
+}
+
+//runs work over 0..count split into one range per thread, returns once every range is done
+void editorParallelFor (int count, void (*work)(ParallelJob*), void* arg) {
+	ParallelJob jobs[PARALLEL_MAX_THREADS];
+	pthread_t threads[PARALLEL_MAX_THREADS];
+	int started[PARALLEL_MAX_THREADS];
+	int threadCount = editorThreadCount();
+	int t;
+	
+	if (threadCount > count) { threadCount = count > 0 ? count : 1; }
+	
+	for (t = 0; t < threadCount; t++) {
+		jobs[t].start  = (long long)count * t / threadCount;
+		jobs[t].end    = (long long)count * (t + 1) / threadCount;
+		jobs[t].thread = t;
+		jobs[t].arg    = arg;
+		jobs[t].work   = work;
+		started[t] = 0;
+		
+		//if a thread cant be made its range is just done here instead
+		if (t > 0 && pthread_create(&threads[t], NULL, editorParallelThread, &jobs[t]) == 0) { started[t] = 1; }
+	}
+	
+	work(&jobs[0]);
+	for (t = 1; t < threadCount; t++) {
+		if (started[t]) { pthread_join(threads[t], NULL); }
+		else { work(&jobs[t]); }
+	}
+}
+
+/**** FIND ****/
+
+/*
+	finds query in text, returns where it starts or -1
+	memchr skips to each place the first byte is, it is much quicker than checking every byte
+*/
+int editorFindInText (const char* text, int length, const char* query, int queryLength) {
+	const char* at = text;
+	const char* last = text + length - queryLength; //a match cant start after this
+	
+	if (queryLength == 0) { return 0; }
+	
+	while (at <= last) {
+		at = memchr(at, query[0], last - at + 1);
+		if (at == NULL) { return -1; }
+		if (memcmp(at + 1, query + 1, queryLength - 1) == 0) { return at - text; }
+		at++;
+	}
+	return -1;
+}
+
+//one row that has had its matches replaced, made by the workers and put in place by the ui thread
+typedef struct ReplacedRow {
+	int row;
+	char* text;
+	int length;
+	int matches;
+} ReplacedRow;
+
+typedef struct ReplaceJob {
+	const char* query;
+	int queryLength;
+	const char* with;
+	int withLength;
+	
+	//each thread keeps its own list so they never have to wait on each other
+	ReplacedRow* rows[PARALLEL_MAX_THREADS];
+	int count[PARALLEL_MAX_THREADS];
+	int capacity[PARALLEL_MAX_THREADS];
+} ReplaceJob;
+
+/*
+	builds text with every match swapped, returns NULL if there was nothing to replace
+	the matches are counted first so the new text is allocated once at the right size
+*/
+char* editorReplaceInText (const char* text, int length, ReplaceJob* job, int* newLength, int* matches) {
+	char* out;
+	char* dest;
+	int at = 0;
+	int found;
+	
+	*matches = 0;
+	while ((found = editorFindInText(&text[at], length - at, job->query, job->queryLength)) != -1) {
+		(*matches)++;
+		at += found + job->queryLength;
+	}
+	if (*matches == 0) { return NULL; }
+	
+	*newLength = length + *matches * (job->withLength - job->queryLength);
+	out = malloc(*newLength + 1);
+	if (out == NULL) { die("malloc"); }
+	
+	dest = out;
+	at = 0;
+	while ((found = editorFindInText(&text[at], length - at, job->query, job->queryLength)) != -1) {
+		memcpy(dest, &text[at], found);
+		dest += found;
+		memcpy(dest, job->with, job->withLength);
+		dest += job->withLength;
+		at += found + job->queryLength;
+	}
+	memcpy(dest, &text[at], length - at);
+	out[*newLength] = '\0';
+	return out;
+}
+
+void editorReplaceWorker (ParallelJob* pj) {
+	ReplaceJob* job = pj->arg;
+	int t = pj->thread;
+	char* scratch = NULL; //long rows are copied out of their chunks into this
+	int scratchSize = 0;
+	int i;
+	
+	for (i = pj->start; i < pj->end; i++) {
+		EditorRow* row = &E.rows[i];
+		const char* text = row->rawChars;
+		int newLength, matches;
+		char* replaced;
+		
+		if (row->longRow) {
+			if (scratchSize < row->rawLength) {
+				scratchSize = row->rawLength;
+				scratch = realloc(scratch, scratchSize);
+				if (scratch == NULL) { die("realloc"); }
+			}
+			editorRowCopy(row, 0, row->rawLength, scratch);
+			text = scratch;
+		}
+		
+		replaced = editorReplaceInText(text, row->rawLength, job, &newLength, &matches);
+		if (replaced == NULL) { continue; }
+		
+		if (job->count[t] == job->capacity[t]) {
+			job->capacity[t] = job->capacity[t] ? job->capacity[t] * 2 : 64;
+			job->rows[t] = realloc(job->rows[t], sizeof(ReplacedRow) * job->capacity[t]);
+			if (job->rows[t] == NULL) { die("realloc"); }
+		}
+		job->rows[t][job->count[t]++] = (ReplacedRow){i, replaced, newLength, matches};
+	}
+	free(scratch);
+}
+
+/*
+	replaces every match in the file, the rows are searched and rebuilt in parallel then
+	each changed row is put in and updated once, the whole thing is one undo
+*/
+void editorReplaceAll (const char* query, const char* with) {
+	ReplaceJob job;
+	int matches = 0;
+	int rows = 0;
+	int t, k;
+	
+	memset(&job, 0, sizeof(job));
+	job.query = query;
+	job.queryLength = strlen(query);
+	job.with = with;
+	job.withLength = strlen(with);
+	if (job.queryLength == 0) { return; }
+	
+	//the workers read rawChars directly so the row being typed in cant have a gap
+	if (E.gapRow != -1) { editorRowCloseGap(&E.rows[E.gapRow]); }
+	
+	editorParallelFor(E.numberOfRows, editorReplaceWorker, &job);
+	
+	//an empty group would still end the typing group before it
+	for (t = 0; t < PARALLEL_MAX_THREADS; t++) { rows += job.count[t]; }
+	if (rows > 0) { editorUndoBegin(UNDO_EDIT, -1); }
+	for (t = 0; t < PARALLEL_MAX_THREADS; t++) {
+		for (k = 0; k < job.count[t]; k++) {
+			ReplacedRow* r = &job.rows[t][k];
+			int oldLength;
+			char* old = editorRowTakeText(&E.rows[r->row], &oldLength);
+			
+			editorUndoKeepRow(r->row, old, oldLength);
+			editorRowGiveText(&E.rows[r->row], r->text, r->length);
+			matches += r->matches;
+		}
+		free(job.rows[t]);
+	}
+	
+	if (rows > 0) {
 		E.fileModified++;
-		E.cx--;
+		editorClampCursor();
+	}
+	editorSetStatusMessage("Replaced %d matches on %d lines (Ctrl-Z to undo)", matches, rows);
+}
+
+void editorReplace () {
+	char* query = editorPrompt("Replace: %s (ESC to leave)", NULL);
+	char* with;
+	
+	if (query == NULL) { return; }
+	with = editorPromptAllowEmpty("Replace with: %s (ESC to leave)", NULL, 1); //replacing with nothing deletes the matches
+	if (with) {
+		editorReplaceAll(query, with);
+		free(with);
+	}
+	free(query);
+}
+
+void editorFindCallback(char *query, int key) {
+ 	int i;
+ 	
+	static int lastMatch = -1;
+	static int direction  =  1;
+	
+	static int savedHlLine;
+	static char* savedHl;
+	
+	int current;
+	
+	if (savedHl) {
+		memcpy(E.rows[savedHlLine].hl, savedHl, E.rows[savedHlLine].length); //copies the saved highlighting data back into so its correct colours
+    	free(savedHl);
+    	savedHl = NULL;
+	}
+	
+ 	if (key == '\r' || key == '\x1b') {
+		lastMatch = -1;
+		direction = 1;
+		return;
+	} else if (key == ARROW_RIGHT || key == ARROW_DOWN) {
+		debugOutput("find right");
+		direction = 1;
+	} else if (key == ARROW_LEFT || key == ARROW_UP) {
+		direction = -1;
+	} else {
+		lastMatch = -1;
+		direction = 1;
+	}
+	
+	if (lastMatch == -1) { direction = 1; }
+	current = lastMatch;
+	for (i = 0; i < E.numberOfRows; i++) {
+		int matchStart;
+		EditorRow* row;
+	
+		current += direction;
+		if (current == -1) { current = E.numberOfRows - 1; }
+		else if (current == E.numberOfRows) { current = 0; }
+	
+		row = &E.rows[current];
+		matchStart = editorRowFind(row, query); //used to find sub string
+		
+		if (matchStart != -1) {
+			int renderStart, renderEnd;
+			
+			lastMatch = current;
+			editorMakeRowVisible(current); //a match inside a fold opens it
+			E.cy = HEADER_SIZE;
+			editorSetCursorCol(editorRowRawToCol(row, matchStart));
+      		E.yScroll = editorRowToVisible(current);
+      		
+      		//long rows only have the on screen part rendered so there is nothing to mark
+      		if (row->longRow || row->hasGap) { break; }
+			renderStart = editorRowRawToRender(row, matchStart);
+			renderEnd   = editorRowRawToRender(row, matchStart + strlen(query));
+
+			savedHlLine = current;
+			savedHl = malloc(row->length);
+			memcpy(savedHl, row->hl, row->length);
+      		
+			memset(&row->hl[renderStart], HL_MATCH, renderEnd - renderStart);
+      		break;
+		}		
+	} 
+	
+	return;
+}
+
+void editorFind () {
+	int saved_cx = E.cx;
+	int saved_cy = E.cy;
+	int saved_yScroll = E.yScroll;
+	int saved_xScroll = E.xScroll;
+	char* query = editorPrompt("Search: %s (ESC to leave)", editorFindCallback);	
+	
+	if (query) {
+		free(query);
+	} else {
+		E.cx = saved_cx;
+		E.cy = saved_cy;
+		E.yScroll = saved_yScroll;
+		E.xScroll = saved_xScroll;
+	}
+}
+
+
+/**** FILTER ****/
+/*
+	shows only the rows that have the filter text in them, the rows are checked in parallel
+	typing more onto the filter only checks the rows that already matched
+*/
+
+typedef struct FilterJob {
+	const char* query;
+	const int* candidates; //the rows to check, NULL means all of them
+	
+	int* found[PARALLEL_MAX_THREADS];
+	int count[PARALLEL_MAX_THREADS];
+	int capacity[PARALLEL_MAX_THREADS];
+} FilterJob;
+
+void editorFilterWorker (ParallelJob* pj) {
+	FilterJob* job = pj->arg;
+	int t = pj->thread;
+	int i;
+	
+	for (i = pj->start; i < pj->end; i++) {
+		int row = job->candidates ? job->candidates[i] : i;
+		
+		if (editorRowFind(&E.rows[row], job->query) == -1) { continue; }
+		if (job->count[t] == job->capacity[t]) {
+			job->capacity[t] = job->capacity[t] ? job->capacity[t] * 2 : 256;
+			job->found[t] = realloc(job->found[t], sizeof(int) * job->capacity[t]);
+			if (job->found[t] == NULL) { die("realloc"); }
+		}
+		job->found[t][job->count[t]++] = row;
+	}
+}
+
+//sets or clears filtered on the rows in the filter
+void editorFilterMark (int filtered) {
+	int i;
+	
+	for (i = 0; i < E.filterCount; i++) { E.rows[E.filterRows[i]].filtered = filtered; }
+}
+
+void editorFilterApply (const char* query) {
+	FilterJob job;
+	int refine = E.filterActive && strstr(query, E.filterQuery) != NULL; //every row that matches this matched the last one
+	int* rows;
+	int total = 0;
+	int t;
+	
+	memset(&job, 0, sizeof(job));
+	job.query = query;
+	job.candidates = refine ? E.filterRows : NULL;
+	
+	//editorRowFind would close the gap from the workers otherwise
+	if (E.gapRow != -1) { editorRowCloseGap(&E.rows[E.gapRow]); }
+	
+	editorParallelFor(refine ? E.filterCount : E.numberOfRows, editorFilterWorker, &job);
+	
+	//each thread has its own stretch of rows so putting them end to end keeps them in order
+	for (t = 0; t < PARALLEL_MAX_THREADS; t++) { total += job.count[t]; }
+	rows = malloc(sizeof(int) * (total ? total : 1));
+	if (rows == NULL) { die("malloc"); }
+	total = 0;
+	for (t = 0; t < PARALLEL_MAX_THREADS; t++) {
+		if (job.count[t]) { memcpy(&rows[total], job.found[t], sizeof(int) * job.count[t]); }
+		total += job.count[t];
+		free(job.found[t]);
+	}
+	
+	editorFilterMark(0);
+	free(E.filterRows);
+	free(E.filterQuery);
+	E.filterRows = rows;
+	E.filterCount = total;
+	E.filterCapacity = total ? total : 1;
+	E.filterQuery = strdup(query);
+	E.filterActive = 1;
+	editorFilterMark(1);
+	E.wrapTreeDirty = 1;
+}
+
+void editorFilterClear () {
+	editorFilterMark(0);
+	free(E.filterRows);
+	free(E.filterQuery);
+	E.filterRows = NULL;
+	E.filterQuery = NULL;
+	E.filterCount = 0;
+	E.filterCapacity = 0;
+	E.filterActive = 0;
+	E.wrapTreeDirty = 1;
+}
+
+//keeps the cursor on the same row, or the next one that is still shown
+void editorFilterKeepCursor (int line, int col) {
+	int visible = editorRowToVisible(line);
+	
+	if (visible >= editorVisibleCount()) { visible = editorVisibleCount() - 1; }
+	if (visible < 0) {
+		E.cy = HEADER_SIZE;
+		E.yScroll = 0;
+		editorSetCursorCol(0);
+		return;
+	}
+	editorGoToLine(editorVisibleToRow(visible), col);
+	editorClampCursor();
+}
+
+void editorFilterCallback (char* query, int key) {
+	int line = getCurrentLineInFile();
+	int col = getCursorPositionInRenderdFileLine();
+	
+	if (key == '\r') { return; }
+	if (key != '\x1b' && E.filterActive && strcmp(query, E.filterQuery) == 0) { return; } //arrow keys dont change the filter
+	if (key == '\x1b' || query[0] == '\0') {
+		editorFilterClear();
+	} else {
+		editorFilterApply(query);
+	}
+	editorFilterKeepCursor(line, col);
+}
+
+void editorFilter () {
+	char* query = editorPrompt("Filter: %s (ESC to show every line)", editorFilterCallback);
+	
+	if (query) { free(query); }
+}
+
+/**** FUZZY FINDER ****/
+/*
+	jumps to a line from letters that are somewhere in it in order, every row is scored in
+	parallel and each thread keeps a small heap of its best matches so nothing is sorted
+	the threads take chunks of rows off a shared counter, between chunks the ui thread looks
+	for another key and if there is one it moves fuzzyGeneration on so they all give up
+*/
+
+typedef struct FuzzyJob {
+	const char* query;
+	int queryLength;
+	int caseSensitive;
+	int generation;
+	int rows;
+	int next; //the first row no thread has taken yet
+	
+	FuzzyMatch heap[PARALLEL_MAX_THREADS][FUZZY_TOP_K];
+	int heapCount[PARALLEL_MAX_THREADS];
+	int matched[PARALLEL_MAX_THREADS];
+} FuzzyJob;
+
+char fuzzyFold (char c, int caseSensitive) {
+	return caseSensitive ? c : tolower((unsigned char)c);
+}
+
+/*
+	-1 if the query isnt in the text in order, the first match is found going forwards then
+	walked back from its end so the letters are as close together as they can be
+	letters that follow each other or start words score more, every letter skipped costs one
+*/
+int editorFuzzyScore (const char* text, int length, const char* query, int queryLength, int caseSensitive) {
+	int score = 0;
+	int last = -2;
+	int start, end, i, q;
+	
+	for (i = 0, q = 0; i < length && q < queryLength; i++) {
+		if (fuzzyFold(text[i], caseSensitive) == query[q]) { q++; }
+	}
+	if (q < queryLength) { return -1; }
+	end = i;
+	
+	for (i = end - 1, q = queryLength - 1; q >= 0; i--) {
+		if (fuzzyFold(text[i], caseSensitive) == query[q]) { q--; }
+	}
+	start = i + 1;
+	
+	for (i = start, q = 0; q < queryLength; i++) {
+		if (fuzzyFold(text[i], caseSensitive) != query[q]) { continue; }
+		
+		score += FUZZY_SCORE_MATCH;
+		if (i == last + 1) { score += FUZZY_SCORE_CONSECUTIVE; }
+		if (i == 0 || !isalnum((unsigned char)text[i - 1])) { score += FUZZY_SCORE_BOUNDARY; }
+		last = i;
+		q++;
+	}
+	
+	score -= (end - start) - queryLength;
+	return (score > 0) ? score : 0;
+}
+
+//lower scores are worse, and for the same score the later row is
+int editorFuzzyWorse (const FuzzyMatch* a, const FuzzyMatch* b) {
+	return a->score < b->score || (a->score == b->score && a->row > b->row);
+}
+
+//the heap has the worst match at the top so it is the one pushed out once the heap is full
+void editorFuzzyHeapPush (FuzzyMatch* heap, int* count, FuzzyMatch match) {
+	int i;
+	
+	if (*count < FUZZY_TOP_K) {
+		i = (*count)++;
+		while (i > 0 && editorFuzzyWorse(&match, &heap[(i - 1) / 2])) {
+			heap[i] = heap[(i - 1) / 2];
+			i = (i - 1) / 2;
+		}
+		heap[i] = match;
+		return;
+	}
+	
+	if (!editorFuzzyWorse(&heap[0], &match)) { return; }
+	i = 0;
+	while (1) {
+		int child = i * 2 + 1;
+		
+		if (child >= *count) { break; }
+		if (child + 1 < *count && editorFuzzyWorse(&heap[child + 1], &heap[child])) { child++; }
+		if (!editorFuzzyWorse(&heap[child], &match)) { break; }
+		heap[i] = heap[child];
+		i = child;
+	}
+	heap[i] = match;
+}
+
+int editorInputWaiting () {
+	struct pollfd fd = { STDIN_FILENO, POLLIN, 0 };
+	
+	return poll(&fd, 1, 0) > 0;
+}
+
+int editorFuzzyRowScore (FuzzyJob* job, EditorRow* row) {
+	//long rows are only scored on their first chunk, it is how a line starts that is remembered
+	if (row->longRow) {
+		RowChunk* chunk = &row->longRow->chunks[0];
+		
+		return editorFuzzyScore(chunk->data, chunk->length, job->query, job->queryLength, job->caseSensitive);
+	}
+	return editorFuzzyScore(row->rawChars, row->rawLength, job->query, job->queryLength, job->caseSensitive);
+}
+
+//every thread is given one range, the rows themselves come off job->next
+void editorFuzzyWorker (ParallelJob* pj) {
+	FuzzyJob* job = pj->arg;
+	int t = pj->thread;
+	
+	while (__atomic_load_n(&E.fuzzyGeneration, __ATOMIC_RELAXED) == job->generation) {
+		int start = __atomic_fetch_add(&job->next, FUZZY_CHUNK_ROWS, __ATOMIC_RELAXED);
+		int end = start + FUZZY_CHUNK_ROWS;
+		int i;
+		
+		if (start >= job->rows) { return; }
+		if (end > job->rows) { end = job->rows; }
+		
+		for (i = start; i < end; i++) {
+			FuzzyMatch match;
+			
+			match.score = editorFuzzyRowScore(job, &E.rows[i]);
+			if (match.score < 0) { continue; }
+			match.row = i;
+			job->matched[t]++;
+			editorFuzzyHeapPush(job->heap[t], &job->heapCount[t], match);
+		}
+		
+		if (t == 0 && editorInputWaiting()) { __atomic_add_fetch(&E.fuzzyGeneration, 1, __ATOMIC_RELAXED); }
+	}
+}
+
+int editorFuzzyCompare (const void* a, const void* b) {
+	if (editorFuzzyWorse(b, a)) { return -1; }
+	if (editorFuzzyWorse(a, b)) { return 1; }
+	return 0;
+}
+
+//returns 0 if a key came in before every row was scored, the old results are left up then
+int editorFuzzyScoreRows (const char* query) {
+	FuzzyJob* job = calloc(1, sizeof(FuzzyJob));
+	FuzzyMatch all[PARALLEL_MAX_THREADS * FUZZY_TOP_K];
+	char* folded = strdup(query);
+	int count = 0;
+	int t, i;
+	
+	if (job == NULL || folded == NULL) { die("malloc"); }
+	
+	//smart case, an upper case letter in the query means case matters
+	job->caseSensitive = 0;
+	for (i = 0; query[i]; i++) {
+		if (isupper((unsigned char)query[i])) { job->caseSensitive = 1; }
+	}
+	for (i = 0; !job->caseSensitive && folded[i]; i++) { folded[i] = tolower((unsigned char)folded[i]); }
+	job->query = folded;
+	job->queryLength = strlen(folded);
+	job->rows = E.numberOfRows;
+	job->generation = __atomic_load_n(&E.fuzzyGeneration, __ATOMIC_RELAXED);
+	
+	//the workers read rawChars directly so the typing gap has to be closed first
+	if (E.gapRow != -1) { editorRowCloseGap(&E.rows[E.gapRow]); }
+	
+	editorParallelFor(editorThreadCount(), editorFuzzyWorker, job);
+	
+	if (__atomic_load_n(&E.fuzzyGeneration, __ATOMIC_RELAXED) != job->generation) {
+		free(folded);
+		free(job);
+		return 0;
+	}
+	
+	E.fuzzyMatched = 0;
+	for (t = 0; t < PARALLEL_MAX_THREADS; t++) {
+		memcpy(&all[count], job->heap[t], sizeof(FuzzyMatch) * job->heapCount[t]);
+		count += job->heapCount[t];
+		E.fuzzyMatched += job->matched[t];
+	}
+	qsort(all, count, sizeof(FuzzyMatch), editorFuzzyCompare);
+	if (count > FUZZY_TOP_K) { count = FUZZY_TOP_K; }
+	memcpy(E.fuzzyResults, all, sizeof(FuzzyMatch) * count);
+	E.fuzzyCount = count;
+	E.fuzzySelected = 0;
+	
+	free(folded);
+	free(job);
+	return 1;
+}
+
+//the start of a row with tabs and control charicters as spaces, cut to fit in width
+void editorFuzzyDrawText (struct abuf* buff, EditorRow* row, int width) {
+	int length = row->rawLength;
+	char* text;
+	int cols = 0;
+	int i;
+	
+	if (width <= 0) { return; }
+	if (length > width * 4) { length = width * 4; } //enough for the widest utf8
+	text = malloc(length ? length : 1);
+	if (text == NULL) { die("malloc"); }
+	editorRowCopy(row, 0, length, text);
+	
+	for (i = 0; i < length; i++) {
+		unsigned char c = text[i];
+		
+		if ((c & 0xc0) != 0x80 && cols++ == width) { break; } //continuation bytes dont take up a column
+		if (c < 32 || c == 127) { text[i] = ' '; }
+	}
+	abufAppend(buff, text, i);
+	free(text);
+}
+
+//the matches are drawn over the bottom of the text with the best one just above the status bar
+void editorFuzzyDrawPopup (struct abuf* buff) {
+	int textRows = E.screenRows - HEADER_SIZE - 1;
+	int lines = E.fuzzyCount;
+	char line[64];
+	int length, top, i;
+	
+	if (lines > textRows - 1) { lines = textRows - 1; }
+	if (lines < 0) { return; }
+	top = HEADER_SIZE + textRows - lines; //the screen row of the best match is top + lines - 1
+	
+	length = snprintf(line, sizeof(line), "\x1b[%d;1H\x1b[K\x1b[7m %d/%d lines match \x1b[0m", top, E.fuzzyMatched, E.numberOfRows);
+	abufAppend(buff, line, length);
+	
+	for (i = 0; i < lines; i++) {
+		int result = lines - 1 - i;
+		int row = E.fuzzyResults[result].row;
+		
+		length = snprintf(line, sizeof(line), "\x1b[%d;1H\x1b[K%s%7d ", top + i + 1, (result == E.fuzzySelected) ? "\x1b[7m" : "", row + 1);
+		abufAppend(buff, line, length);
+		if (row < E.numberOfRows) { editorFuzzyDrawText(buff, &E.rows[row], E.screenCols - 8); }
+		abufAppend(buff, "\x1b[0m", 4);
+	}
+}
+
+void editorFuzzyCallback (char* query, int key) {
+	if (key == '\r') {
+		if (E.fuzzyCount > 0 && E.fuzzyResults[E.fuzzySelected].row < E.numberOfRows) {
+			editorGoToLine(E.fuzzyResults[E.fuzzySelected].row, 0);
+		}
+		return;
+	}
+	if (key == '\x1b') { return; }
+	
+	//the list is upside down so up goes to a worse match
+	if (key == ARROW_UP && E.fuzzySelected < E.fuzzyCount - 1) { E.fuzzySelected++; }
+	if (key == ARROW_DOWN && E.fuzzySelected > 0) { E.fuzzySelected--; }
+	
+	if (E.fuzzyQuery && strcmp(query, E.fuzzyQuery) == 0) { return; }
+	free(E.fuzzyQuery);
+	E.fuzzyQuery = NULL;
+	
+	if (query[0] == '\0') {
+		E.fuzzyCount = 0;
+		E.fuzzyMatched = 0;
+		E.fuzzyQuery = strdup(query);
+		return;
+	}
+	if (editorFuzzyScoreRows(query)) { E.fuzzyQuery = strdup(query); }
+}
+
+void editorFuzzyFind () {
+	char* query;
+	
+	E.fuzzyActive = 1;
+	E.fuzzyCount = 0;
+	E.fuzzyMatched = 0;
+	E.fuzzySelected = 0;
+	
+	query = editorPrompt("Go to: %s (ESC to cancel)", editorFuzzyCallback);
+	
+	E.fuzzyActive = 0;
+	free(E.fuzzyQuery);
+	E.fuzzyQuery = NULL;
+	if (query) { free(query); }
+}
+
+/**** DIRECTORY SEARCH ****/
+/*
+	looks for text in every file under the working directory, the tree is walked by a few threads
+	sharing a stack of paths, a directory pushes what is in it and a file is mapped and scanned
+	each file hands its matches over as a batch of "path:line: text" rows so they stay together
+	there are twice as many threads as cores so some can wait on the disk while others scan
+*/
+
+typedef struct SearchState {
+	char* query;
+	int queryLength;
+	int generation;
+	
+	pthread_mutex_t lock; //guards everything below
+	pthread_cond_t ready; //a path was pushed or the last busy thread finished
+	char** paths;
+	int pathCount;
+	int pathCapacity;
+	int busy; //threads working on a path, they might push more
+	int threads; //threads still running, the last one out frees this
+	int files;
+	int matches;
+} SearchState;
+
+//a batch of result rows one after another, each ending in a new line
+typedef struct SearchBatch {
+	char* text;
+	size_t length;
+	size_t capacity;
+	int count;
+} SearchBatch;
+
+int editorSearchStale (SearchState* search) {
+	return __atomic_load_n(&E.searchGeneration, __ATOMIC_RELAXED) != search->generation;
+}
+
+//caller must hold search->lock
+void editorSearchPush (SearchState* search, char* path) {
+	if (search->pathCount == search->pathCapacity) {
+		search->pathCapacity = search->pathCapacity ? search->pathCapacity * 2 : 64;
+		search->paths = realloc(search->paths, sizeof(char*) * search->pathCapacity);
+		if (search->paths == NULL) { die("realloc"); }
+	}
+	search->paths[search->pathCount++] = path;
+}
+
+void editorSearchBatchAppend (SearchBatch* batch, const char* text, size_t length) {
+	if (batch->length + length > batch->capacity) {
+		batch->capacity = (batch->length + length) * 2;
+		batch->text = realloc(batch->text, batch->capacity);
+		if (batch->text == NULL) { die("realloc"); }
+	}
+	memcpy(&batch->text[batch->length], text, length);
+	batch->length += length;
+}
+
+//adds the batch to the end of the rows, unless a newer search or an opened file has taken over
+void editorSearchFlush (SearchState* search, SearchBatch* batch) {
+	char* at = batch->text;
+	char* end = batch->text + batch->length;
+	
+	if (batch->count == 0) { return; }
+	
+	editorLockRows();
+	if (!editorSearchStale(search)) {
+		while (at < end) {
+			char* newLine = memchr(at, '\n', end - at);
+			
+			editorIngestLine(at, newLine - at);
+			at = newLine + 1;
+		}
+	}
+	editorUnlockRows();
+	editorRequestRedraw();
+	
+	pthread_mutex_lock(&search->lock);
+	search->matches += batch->count;
+	pthread_mutex_unlock(&search->lock);
+	batch->length = 0;
+	batch->count = 0;
+}
+
+void editorSearchFile (SearchState* search, const char* path) {
+	SearchBatch batch = {NULL, 0, 0, 0};
+	size_t pathLength = strlen(path);
+	size_t size, pos, counted;
+	int line = 1; //the line counted is on
+	char* text = editorMapFile(path, &size);
+	
+	if (text == NULL || size == 0) { return; }
+	madvise(text, size, MADV_SEQUENTIAL);
+	
+	//the same check that opens a file as hex, results from a binary file are no use
+	if (memchr(text, '\0', size < HEX_SNIFF_SIZE ? size : HEX_SNIFF_SIZE)) {
+		editorUnmapFile(text, size);
+		return;
+	}
+	
+	pos = 0;
+	counted = 0;
+	while (pos < size && !editorSearchStale(search)) {
+		size_t window = size - pos;
+		char number[24];
+		char* lineEnd;
+		size_t match, lineStart, length;
+		int at;
+		
+		if (window > SEARCH_SCAN_WINDOW) { window = SEARCH_SCAN_WINDOW; }
+		at = editorFindInText(&text[pos], window, search->query, search->queryLength);
+		if (at == -1) {
+			if (window == size - pos) { break; }
+			pos += window - search->queryLength + 1; //the next window starts far enough back to find a match across the edge
+			continue;
+		}
+		match = pos + at;
+		
+		//the new lines are only counted up to each match, memchr skips along them quickly
+		while (1) {
+			char* newLine = memchr(&text[counted], '\n', match - counted);
+			
+			if (newLine == NULL) { break; }
+			counted = newLine - text + 1;
+			line++;
+		}
+		lineStart = counted;
+		lineEnd = memchr(&text[match], '\n', size - match);
+		length = (lineEnd ? (size_t)(lineEnd - text) : size) - lineStart;
+		if (length > SEARCH_TEXT_MAX) { length = SEARCH_TEXT_MAX; }
+		
+		editorSearchBatchAppend(&batch, path, pathLength);
+		editorSearchBatchAppend(&batch, number, snprintf(number, sizeof(number), ":%d: ", line));
+		editorSearchBatchAppend(&batch, &text[lineStart], length);
+		editorSearchBatchAppend(&batch, "\n", 1);
+		batch.count++;
+		if (batch.length >= SEARCH_FLUSH_SIZE) { editorSearchFlush(search, &batch); }
+		
+		//one result a line, the next match is looked for on the line after
+		if (lineEnd == NULL) { break; }
+		pos = counted = lineEnd - text + 1;
+		line++;
 	}
+	
+	editorSearchFlush(search, &batch);
+	free(batch.text);
+	editorUnmapFile(text, size);
 }
 
-/**** OUTPUTS ****/
+//pushes everything in a directory, links arent followed so the walk cant go round in a loop
+void editorSearchReadDir (SearchState* search, const char* path) {
+	DIR* dir = opendir(path);
+	struct dirent* entry;
+	
+	if (dir == NULL) { return; }
+	while ((entry = readdir(dir)) != NULL && !editorSearchStale(search)) {
+		char* child;
+		
+		if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0 || strcmp(entry->d_name, ".git") == 0) { continue; }
+		if (entry->d_type != DT_DIR && entry->d_type != DT_REG && entry->d_type != DT_UNKNOWN) { continue; }
+		
+		//paths under . are shown without the ./ in front
+		if (strcmp(path, ".") == 0) {
+			child = strdup(entry->d_name);
+		} else {
+			child = malloc(strlen(path) + strlen(entry->d_name) + 2);
+			if (child) { sprintf(child, "%s/%s", path, entry->d_name); }
+		}
+		if (child == NULL) { die("malloc"); }
+		
+		pthread_mutex_lock(&search->lock);
+		editorSearchPush(search, child);
+		pthread_cond_signal(&search->ready);
+		pthread_mutex_unlock(&search->lock);
+	}
+	closedir(dir);
+}
 
-void editorSetStatusMessage (const char* fmt, ...) {
+void editorSearchPath (SearchState* search, const char* path) {
+	struct stat st;
+	
+	if (lstat(path, &st) == -1) { return; }
+	if (S_ISDIR(st.st_mode)) {
+		editorSearchReadDir(search, path);
+	} else if (S_ISREG(st.st_mode)) {
+		editorSearchFile(search, path);
+		pthread_mutex_lock(&search->lock);
+		search->files++;
+		pthread_mutex_unlock(&search->lock);
+	}
+}
+
+void editorSearchFinish (SearchState* search) {
+	int i;
+	
+	editorLockRows();
+	if (!editorSearchStale(search)) {
+		editorSetStatusMessage("Found %d matches in %d files, Enter opens one", search->matches, search->files);
+		E.searchActive = 0;
+	}
+	editorUnlockRows();
+	editorRequestRedraw();
+	
+	for (i = 0; i < search->pathCount; i++) { free(search->paths[i]); }
+	free(search->paths);
+	free(search->query);
+	pthread_mutex_destroy(&search->lock);
+	pthread_cond_destroy(&search->ready);
+	free(search);
+}
+
+//takes paths off the stack till there are none left and no thread is busy making more
+void* editorSearchThread (void* arg) {
+	SearchState* search = arg;
+	int last;
+	
+	pthread_mutex_lock(&search->lock);
+	while (1) {
+		char* path;
+		
+		while (search->pathCount == 0 && search->busy > 0 && !editorSearchStale(search)) {
+			pthread_cond_wait(&search->ready, &search->lock);
+		}
+		if (search->pathCount == 0 || editorSearchStale(search)) { break; }
+		
+		path = search->paths[--search->pathCount];
+		search->busy++;
+		pthread_mutex_unlock(&search->lock);
+		
+		editorSearchPath(search, path);
+		free(path);
+		
+		pthread_mutex_lock(&search->lock);
+		search->busy--;
+		if (search->busy == 0) { pthread_cond_broadcast(&search->ready); }
+	}
+	pthread_cond_broadcast(&search->ready); //anyone still waiting needs to see it is over too
+	last = (--search->threads == 0);
+	pthread_mutex_unlock(&search->lock);
+	
+	if (last) { editorSearchFinish(search); }
+	return NULL;
+}
+
+//the rows are swapped for the results, caller must hold the rows lock
+void editorSearchStart (const char* query) {
+	SearchState* search = calloc(1, sizeof(SearchState));
+	pthread_t thread;
+	int threads = editorThreadCount() * 2;
+	int t;
+	
+	if (search == NULL) { die("calloc"); }
+	if (threads > PARALLEL_MAX_THREADS) { threads = PARALLEL_MAX_THREADS; }
+	
+	//a search that is still going stops adding rows as soon as this goes up
+	search->generation = __atomic_add_fetch(&E.searchGeneration, 1, __ATOMIC_RELAXED);
+	search->query = strdup(query);
+	search->queryLength = strlen(query);
+	pthread_mutex_init(&search->lock, NULL);
+	pthread_cond_init(&search->ready, NULL);
+	editorSearchPush(search, strdup("."));
+	
+	editorCloseFile();
+	E.searchQuery = strdup(query);
+	E.searchActive = 1;
+	
+	/*
+		the threads wait on the search lock before they do anything, so holding it while they are
+		made means none can finish before the count is set to how many were really made, the last
+		one out is always a thread and never this one that is holding the rows lock
+	*/
+	pthread_mutex_lock(&search->lock);
+	for (t = 0; t < threads; t++) {
+		if (pthread_create(&thread, NULL, editorSearchThread, search) != 0) { break; }
+		pthread_detach(thread);
+	}
+	if (t == 0) { die("pthread_create"); }
+	search->threads = t;
+	pthread_mutex_unlock(&search->lock);
+}
+
+void editorSearchDirectory () {
+	char* query;
+	
+	if (E.ingestActive) {
+		editorSetStatusMessage("Wait for the file to finish reading before searching");
+		return;
+	}
+	if (E.fileModified && E.searchQuery == NULL) {
+		editorSetStatusMessage("Save the file before searching (Ctrl-S)");
+		return;
+	}
+	
+	query = editorPrompt("Search files under here: %s (ESC to cancel)", NULL);
+	if (query == NULL) { return; }
+	editorSearchStart(query);
+	free(query);
+}
+
+//a result row is "path:line: text", the path is up to the first :number:
+void editorSearchOpenResult () {
+	int line = getCurrentLineInFile();
+	EditorRow* row;
+	char* text;
+	char* colon;
+	int target = 0;
+	
+	if (line < 0 || line >= E.numberOfRows) { return; }
+	row = &E.rows[line];
+	text = malloc(row->rawLength + 1);
+	if (text == NULL) { die("malloc"); }
+	editorRowCopy(row, 0, row->rawLength, text);
+	text[row->rawLength] = '\0';
+	
+	for (colon = strchr(text, ':'); colon; colon = strchr(colon + 1, ':')) {
+		char* end;
+		
+		target = strtol(colon + 1, &end, 10);
+		if (end != colon + 1 && *end == ':' && isdigit((unsigned char)colon[1])) { break; }
+	}
+	if (colon == NULL || colon == text) {
+		editorSetStatusMessage("Not a search result");
+		free(text);
+		return;
+	}
+	*colon = '\0';
+	
+	if (editorSwitchFile(text) == -1) {
+		free(text);
+		return;
+	}
+	editorGoToLine(target > 0 ? target - 1 : 0, 0);
+	free(text);
+}
+
+/**** SERVER ****/
+/*
+	"editor --server /tmp/sock file" lets scripts edit through a unix socket, one command a line:
+	
+		open PATH            goto LINE [COL]      insert TEXT      delete COUNT
+		find TEXT            replace OLD NEW      save             batch COUNT
+	
+	lines and columns count from 1, columns are bytes, in text \n is a new line, \t a tab,
+	\s a space (needed in OLD and NEW) and \\ a backslash
+	each command gets "OK line col" back with where the cursor is, or "ERR message"
+	batch runs the next COUNT commands as one undo and only redraws after, if one fails the
+	rest are not run and the ones before are undone, open and save cant be in a batch
+*/
+
+void editorServerStart (const char* path) {
+	struct sockaddr_un addr;
+	struct stat st;
+	
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(addr.sun_path)) { die("socket path too long"); }
+	strcpy(addr.sun_path, path);
+	
+	E.serverFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (E.serverFd == -1) { die("socket"); }
+	//a socket left behind by an editor that didnt exit cleanly is taken over, anything else there is left alone
+	if (lstat(path, &st) == 0) {
+		if (!S_ISSOCK(st.st_mode)) {
+			errno = EEXIST;
+			die(path);
+		}
+		unlink(path);
+	}
+	if (bind(E.serverFd, (struct sockaddr*)&addr, sizeof(addr)) == -1) { die("bind"); }
+	if (listen(E.serverFd, SERVER_MAX_CLIENTS) == -1) { die("listen"); }
+	E.serverPath = strdup(path);
+	editorWatchFd(E.serverFd);
+}
+
+void editorServerStop () {
+	if (E.serverPath) { unlink(E.serverPath); }
+}
+
+void editorServerClose (ServerClient* client) {
+	epoll_ctl(E.epollFd, EPOLL_CTL_DEL, client->fd, NULL);
+	close(client->fd);
+	free(client->buffer);
+	client->fd = -1;
+	client->buffer = NULL;
+	client->length = 0;
+	client->capacity = 0;
+}
+
+//a client that isnt reading its replies is dropped rather than let it stop the ui
+void editorServerReply (ServerClient* client, const char* fmt, ...) {
+	char reply[256];
 	va_list ap;
+	int length;
+	
 	va_start(ap, fmt);
-	vsnprintf(E.statusMsg, sizeof(E.statusMsg), fmt, ap);
+	length = vsnprintf(reply, sizeof(reply) - 1, fmt, ap);
 	va_end(ap);
-	E.statusMsgTime = time(NULL);
+	if (length > (int)sizeof(reply) - 2) { length = sizeof(reply) - 2; }
+	reply[length++] = '\n';
+	
+	if (send(client->fd, reply, length, MSG_DONTWAIT | MSG_NOSIGNAL) != length) { editorServerClose(client); }
 }
 
-/*
-This is the function that is used to draw the editor row by row onto the screen!
-*/
-void editorDrawRows (struct abuf* buff) { 
-    int y;
-    int headerPadding;
-    char header[80];
-    int headerLen = snprintf(header, sizeof(header), HEADER_MESSAGE);
+//turns the escapes in text into what they stand for, in place, returns the new length
+int editorServerUnescape (char* text) {
+	char* from = text;
+	char* to = text;
+	
+	while (*from) {
+		if (*from == '\\' && from[1]) {
+			from++;
+			switch (*from) {
+				case 'n': *to++ = '\n'; break;
+				case 't': *to++ = '\t'; break;
+				case 's': *to++ = ' '; break;
+				default: *to++ = *from; break;
+			}
+			from++;
+		} else {
+			*to++ = *from++;
+		}
+	}
+	*to = '\0';
+	return to - text;
+}
 
-	// this is drawing the header
-	{
-		int i = 0;
+//the next match after the cursor, going round to the top of the file
+int editorServerFind (const char* query) {
+	int line = getCurrentLineInFile();
+	int at = getCursorPositionInRawFileLine() + 1;
+	int queryLength = strlen(query);
+	int i;
+	
+	if (E.numberOfRows == 0 || queryLength == 0) { return -1; }
+	if (line >= E.numberOfRows) { line = E.numberOfRows - 1; }
+	
+	//the rest of the cursor row is looked at first, and the whole of it last
+	for (i = 0; i <= E.numberOfRows; i++) {
+		int current = (line + i) % E.numberOfRows;
+		EditorRow* row = &E.rows[current];
+		int match;
 		
-		if (headerLen > E.screenCols) { headerLen = E.screenCols; }
-		headerPadding = (E.screenCols - headerLen) / 2;
-		    
-		abufAppend(buff, "\x1b[K", 3); //clear lines as they are re-drawn
-		abufAppend(buff, "\x1b[7m", 4);
-		abufAppend(buff, "\x1b[1m", 4);
-		abufAppend(buff, "~", 1);
-		headerPadding--;
+		if (i == 0) {
+			char* text;
+			
+			if (at >= row->rawLength) { continue; }
+			text = malloc(row->rawLength - at);
+			if (text == NULL) { die("malloc"); }
+			editorRowCopy(row, at, row->rawLength - at, text);
+			match = editorFindInText(text, row->rawLength - at, query, queryLength);
+			free(text);
+			if (match != -1) { match += at; }
+		} else {
+			match = editorRowFind(row, query);
+		}
 		
-		i = headerPadding;
-		while (i--) { abufAppend(buff, " ", 1); }
+		if (match != -1) {
+			editorGoToLine(current, editorRowRawToCol(row, match));
+			return 0;
+		}
+	}
+	return -1;
+}
 
-		abufAppend(buff, header, headerLen);
+//deletes forward from the cursor, at the end of a row it joins the next one on like backspace does
+void editorServerDelete (int count) {
+	while (count-- > 0) {
+		int line = getCurrentLineInFile();
 		
-		i = headerPadding + 1;
-		while (i--) { abufAppend(buff, " ", 1); }
+		if (line >= E.numberOfRows) { return; }
+		if (getCursorPositionInRawFileLine() < E.rows[line].rawLength) {
+			editorDeleteChar();
+		} else if (line + 1 < E.numberOfRows) {
+			editorGoToLine(line + 1, 0);
+			E.cx--;
+			editorDeleteChar();
+		} else {
+			return;
+		}
+	}
+}
+
+//runs one command, returns -1 and fills in error if it couldnt be done
+int editorServerCommand (char* command, int inBatch, char* error, size_t errorSize) {
+	char* arg = strchr(command, ' ');
+	
+	if (arg) { *arg++ = '\0'; }
+	else { arg = command + strlen(command); }
+	
+	if (E.hexActive) {
+		snprintf(error, errorSize, "the hex view is open");
+		return -1;
+	}
+	
+	if (strcmp(command, "goto") == 0) {
+		int line = 0;
+		int col = 1;
 		
-		abufAppend(buff, "\x1b[0m", 4);
-		abufAppend(buff, "\r\n", 2);
-    }
-    
-    for (y = 0; y < E.screenRows - HEADER_SIZE - 1; y++) { // this -1 is for the status bar at the bottom of the page 
-    	int lineNumber = y + E.yScroll;
-    	
-    	abufAppend(buff, "\x1b[K", 3); //clear lines as they are re-drawn
-		abufAppend(buff, "~ ", LINE_START_SIZE);
-  		  
-        if (lineNumber < E.numberOfRows) {    
-            char* c;
-            unsigned char* hl;
-            int i;
-            int len = E.rows[lineNumber].length - E.xScroll;
-            
-            int currentColour = -1;
-            
-            if (len > E.screenCols) { len = E.screenCols - LINE_START_SIZE; } //compoensate for the start of the line e.g. line numbers
-            if (len < 0) { continue; }
-            
-            c  = &E.rows[lineNumber].chars[E.xScroll];
-			hl = &E.rows[lineNumber].hl[E.xScroll];			
-			            
-            for (i = 0; i < len; i++) {
-            	if (hl[i] == HL_NORMAL) {
-            		if (currentColour == -1) {
-						abufAppend(buff, "\x1b[39m", 5);
-						currentColour = -1;
-					}
-					abufAppend(buff, &c[i], 1);
-            	} else {
-            		int color = editorSyntaxToColor(hl[i]);
-            		if (color != currentColour) {
-            		
-            			currentColour = color;
-            		}
-            		
-            		char buf[16];
-            		int clen = snprintf(buf, sizeof(buf), "\x1b[%dm", color);
-            		abufAppend(buff, buf, clen);
-					abufAppend(buff, &c[i], 1);
-				}  
-				
-				abufAppend(buff, "\x1b[39m", 5); 
-			}         
-        }
-        
-        abufAppend(buff, "\r\n", 2);
-    }
-    
-    {
-		//drawing status bar
-		int tempStrLen;
-		int len;
+		if (sscanf(arg, "%d %d", &line, &col) < 1 || line < 1 || line > E.numberOfRows) {
+			snprintf(error, errorSize, "no line %s", arg);
+			return -1;
+		}
+		if (col < 1) { col = 1; }
+		if (col - 1 > E.rows[line - 1].rawLength) { col = E.rows[line - 1].rawLength + 1; }
+		editorGoToLine(line - 1, editorRowRawToCol(&E.rows[line - 1], col - 1));
+	} else if (strcmp(command, "insert") == 0) {
+		int length = editorServerUnescape(arg);
+		int i;
 		
-		char tempStr[80];
-	
-		abufAppend(buff, "\x1b[K", 3); //clear lines as they are re-drawn
-		abufAppend(buff, "\x1b[7m", 4);
-		abufAppend(buff, "\x1b[1m", 4);
-		len = 0;
+		for (i = 0; i < length; i++) {
+			if (arg[i] == '\n') { editorInsertNewLine(); }
+			else { editorInsertChar(arg[i]); }
+		}
+	} else if (strcmp(command, "delete") == 0) {
+		editorServerDelete(atoi(arg));
+	} else if (strcmp(command, "find") == 0) {
+		editorServerUnescape(arg);
+		if (editorServerFind(arg) == -1) {
+			snprintf(error, errorSize, "not found");
+			return -1;
+		}
+	} else if (strcmp(command, "replace") == 0) {
+		char* with = strchr(arg, ' ');
 		
-		abufAppend(buff, " FILE PATH: ", 12);
-		len += 12;
-		abufAppend(buff, E.filePath, E.filePathLength);
-		len += E.filePathLength;
+		if (with == NULL) {
+			snprintf(error, errorSize, "replace needs OLD and NEW");
+			return -1;
+		}
+		*with++ = '\0';
+		editorServerUnescape(arg);
+		editorServerUnescape(with);
+		editorReplaceAll(arg, with);
+	} else if (strcmp(command, "open") == 0 || strcmp(command, "save") == 0) {
+		if (inBatch) {
+			snprintf(error, errorSize, "%s cant be in a batch", command);
+			return -1;
+		}
+		if (E.ingestActive) {
+			snprintf(error, errorSize, "still reading the file");
+			return -1;
+		}
 		
-		abufAppend(buff, " LINE NUMBER: ", 14);
-		len += 14;
-	  	tempStrLen = snprintf(tempStr, sizeof(tempStr), "%d/%d", E.cy - 1 + E.yScroll, E.numberOfRows);
-	  	abufAppend(buff, tempStr, tempStrLen);
-	  	len += tempStrLen;
-	  	
-	  	if (time(NULL) - E.statusMsgTime > STATUS_MESSAGE_LIFE_TIME) { editorSetStatusMessage("N/A"); }
+		if (command[0] == 'o') {
+			editorServerUnescape(arg);
+			if (E.fileModified && E.searchQuery == NULL) {
+				snprintf(error, errorSize, "the file has unsaved changes");
+				return -1;
+			}
+			if (editorSwitchFile(arg) == -1) {
+				snprintf(error, errorSize, "%s", E.statusMsg);
+				return -1;
+			}
+		} else {
+			if (E.filePath == NULL) {
+				snprintf(error, errorSize, "the file has no name");
+				return -1;
+			}
+			if (editorSave() == -1) {
+				snprintf(error, errorSize, "%s", E.statusMsg);
+				return -1;
+			}
+		}
+	} else {
+		snprintf(error, errorSize, "unknown command %s", command);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+	the commands in a batch each start their own undo groups, once they have all worked the
+	groups are joined into one so ctrl-z takes the whole batch back, if one fails it is undone
+*/
+int editorServerBatch (char** commands, int count, char* error, size_t errorSize) {
+	int firstRecord = E.undoCount;
+	int i;
+	
+	E.undoKind = UNDO_EDIT; //typing before the batch isnt carried on into it
+	for (i = 0; i < count; i++) {
+		char message[200];
 		
-		abufAppend(buff, " STATUS MESSAGE: ", 17);
-	  	len += 17;
-	  	tempStrLen = snprintf(tempStr, sizeof(tempStr), "%s", E.statusMsg);
-	  	abufAppend(buff, tempStr, tempStrLen);
-	  	len += tempStrLen;
+		if (editorServerCommand(commands[i], 1, message, sizeof(message)) == -1) {
+			snprintf(error, errorSize, "%d: %s", i + 1, message);
+			break;
+		}
+	}
+	
+	if (E.undoCount > firstRecord) {
+		int group = E.undo[firstRecord].group;
+		int k;
 		
-		while (len < E.screenCols) {
-			abufAppend(buff, " ", 1);
-			len++;
-	  	}
-	 	abufAppend(buff, "\x1b[m", 3);
+		for (k = firstRecord; k < E.undoCount; k++) { E.undo[k].group = group; }
+		if (i < count) { editorUndo(); }
 	}
+	E.undoKind = UNDO_EDIT;
+	return (i < count) ? -1 : 0;
 }
 
-int getCurrentLine () {
-	return E.cy + E.yScroll - HEADER_SIZE; //header size needs to be subtracted to get the line yu are on
+//runs every whole command the client has sent, a batch waits till all of its lines are in, returns how many it ran
+int editorServerRun (ServerClient* client) {
+	char* start = client->buffer;
+	char* end = client->buffer + client->length;
+	int ran = 0;
+	
+	while (client->fd != -1 && start < end) {
+		char* commands[SERVER_MAX_BATCH];
+		char error[256];
+		char* newLine = memchr(start, '\n', end - start);
+		char* next;
+		int count = 0;
+		int result;
+		
+		if (newLine == NULL) { break; }
+		*newLine = '\0';
+		if (newLine > start && newLine[-1] == '\r') { newLine[-1] = '\0'; }
+		next = newLine + 1;
+		
+		if (strncmp(start, "batch ", 6) == 0) {
+			int wanted = atoi(start + 6);
+			
+			if (wanted < 0 || wanted > SERVER_MAX_BATCH) {
+				editorServerReply(client, "ERR a batch can have at most %d commands", SERVER_MAX_BATCH);
+				start = next;
+				continue;
+			}
+			while (count < wanted) {
+				char* line = memchr(next, '\n', end - next);
+				
+				if (line == NULL) { break; }
+				*line = '\0';
+				if (line > next && line[-1] == '\r') { line[-1] = '\0'; }
+				commands[count++] = next;
+				next = line + 1;
+			}
+			if (count < wanted) { //put the new lines back and wait for the rest
+				int k;
+				
+				*newLine = '\n';
+				for (k = 0; k < count; k++) { commands[k][strlen(commands[k])] = '\n'; }
+				break;
+			}
+			result = editorServerBatch(commands, count, error, sizeof(error));
+		} else {
+			result = editorServerCommand(start, 0, error, sizeof(error));
+		}
+		
+		if (result == 0) {
+			editorServerReply(client, "OK %d %d", getCurrentLineInFile() + 1, getCursorPositionInRawFileLine() + 1);
+		} else {
+			editorServerReply(client, "ERR %s", error);
+		}
+		start = next;
+		ran++;
+	}
+	
+	if (client->fd == -1) { return ran; }
+	client->length = end - start;
+	memmove(client->buffer, start, client->length);
+	return ran;
 }
 
-char getCurrentSelctedChar () {
-	if (E.cx - LINE_START_SIZE > E.rows[getCurrentLine()].length) { return 0; }
-	return E.rows[getCurrentLine()].chars[getCursorPositionInRawFileLine()];
+void editorServerAccept () {
+	int fd;
+	
+	while ((fd = accept4(E.serverFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) != -1) {
+		int i;
+		
+		for (i = 0; i < SERVER_MAX_CLIENTS && E.serverClients[i].fd != -1; i++) {}
+		if (i == SERVER_MAX_CLIENTS) {
+			close(fd);
+			continue;
+		}
+		E.serverClients[i].fd = fd;
+		editorWatchFd(fd);
+	}
 }
 
-void editorRefreshScreen () {
-	char cbuff[32];
+//called with the rows locked when the socket or a client has something
+void editorServerEvent () {
+	int i;
+	
+	if (E.serverFd == -1) { return; }
+	editorServerAccept();
+	
+	for (i = 0; i < SERVER_MAX_CLIENTS; i++) {
+		ServerClient* client = &E.serverClients[i];
+		ssize_t nread;
+		int closed = 0; //worked out straight after the read, running commands changes errno
+		
+		if (client->fd == -1) { continue; }
+		while (1) {
+			if (client->capacity - client->length < SERVER_READ_SIZE) {
+				client->capacity = client->capacity * 2 + SERVER_READ_SIZE;
+				client->buffer = realloc(client->buffer, client->capacity);
+				if (client->buffer == NULL) { die("realloc"); }
+			}
+			nread = read(client->fd, &client->buffer[client->length], SERVER_READ_SIZE);
+			if (nread <= 0) {
+				closed = (nread == 0 || errno != EAGAIN);
+				break;
+			}
+			client->length += nread;
+			
+			//whole commands are run as they come so a long stream of them doesnt pile up
+			if (client->length >= SERVER_MAX_BUFFER && !E.promptActive) { editorServerRun(client); }
+			if (client->fd == -1 || client->length >= SERVER_MAX_BUFFER) { break; }
+		}
+		
+		if (client->fd == -1) { continue; }
+		if (client->length >= SERVER_MAX_BUFFER) {
+			editorServerReply(client, "ERR more than %d bytes are waiting to be run", SERVER_MAX_BUFFER);
+			if (client->fd != -1) { editorServerClose(client); }
+			continue;
+		}
+		
+		if (!E.promptActive) { editorServerRun(client); }
+		if (client->fd != -1 && closed) { editorServerClose(client); }
+	}
+}
 
-    struct abuf buff = ABUF_INIT;
+//commands that came in while a prompt was open are run once it has closed, returns how many ran
+int editorServerPending () {
+	int ran = 0;
+	int i;
+	
+	if (E.serverFd == -1 || E.promptActive) { return 0; }
+	for (i = 0; i < SERVER_MAX_CLIENTS; i++) {
+		if (E.serverClients[i].fd != -1 && E.serverClients[i].length) { ran += editorServerRun(&E.serverClients[i]); }
+	}
+	return ran;
+}
 
-    //hide cursor to stop flickering 
-    abufAppend(&buff, "\x1b[?25l", 6);
-    //puts curse in top left of screen
-    abufAppend(&buff, "\x1b[1;1H", 6);
+/**** HEX VIEW ****/
 
-    editorDrawRows(&buff);
+int editorHexSniff (int fd) {
+	char* buf = malloc(HEX_SNIFF_SIZE);
+	ssize_t nread;
+	int binary;
+	
+	if (buf == NULL) { die("malloc"); }
+	nread = pread(fd, buf, HEX_SNIFF_SIZE, 0);
+	binary = nread > 0 && memchr(buf, '\0', nread) != NULL;
+	free(buf);
+	return binary;
+}
 
-    //puts curse in correct location
-    
-    snprintf(cbuff, sizeof(cbuff), "\x1b[%d;%dH", E.cy + 1, E.cx + 1);
-    abufAppend(&buff, cbuff, strlen(cbuff));
-    
-    abufAppend(&buff, "\x1b[?25h", 6); //show cursor
-    
-    write(STDOUT_FILENO, buff.buffer, buff.length);
-    abufFree(&buff);
+/*
+	maps the file private so bytes typed over stay in memory till they are saved, the view is
+	read only if the file cant be written to
+*/
+int editorHexOpen () {
+	struct stat st;
+	void* data;
+	int fd = open(E.filePath, O_RDONLY);
+	
+	if (fd == -1) { return -1; }
+	if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+		close(fd);
+		return -1;
+	}
+	E.hexWritable = (access(E.filePath, W_OK) == 0);
+	
+	data = mmap(NULL, st.st_size, PROT_READ | (E.hexWritable ? PROT_WRITE : 0), MAP_PRIVATE, fd, 0);
+	if (data == MAP_FAILED) {
+		close(fd);
+		return -1;
+	}
+	E.hexFd = fd;
+	
+	E.hexDirty = calloc((st.st_size / HEX_PAGE_SIZE) / 8 + 1, 1);
+	if (E.hexDirty == NULL) { die("calloc"); }
+	E.hexUndoCount = 0;
+	E.hexSavedUndo = 0;
+	E.hexData = data;
+	E.hexSize = st.st_size;
+	E.hexActive = 1;
+	E.hexChanged = 0;
+	E.hexTop = 0;
+	E.hexCursor = 0;
+	E.hexNibble = 0;
+	return 0;
 }
 
-/**** FILE IO ****/
-/*
-#define MAX_LINE_LENGTH 150 //this is a masive overestimate so will need to be alterd at some point
-char* getNextLine (size_t* length, FILE* file) {
- 
-}   
-*/
+int editorHexPageDirty (size_t page) {
+	return (E.hexDirty[page / 8] >> (page % 8)) & 1;
+}
 
-void editorOpen (char* filePath) {
-	FILE *fp = fopen(filePath, "r");
+//writes the pages with bytes that were typed over out to the file, runs of pages go in one write
+void editorHexSave () {
+	size_t pages = (E.hexSize + HEX_PAGE_SIZE - 1) / HEX_PAGE_SIZE;
+	size_t page = 0;
+	int fd;
 	
-	char *line = NULL;
-	size_t lineCap = 0;
-	ssize_t lineLen = 0;
+	if (!E.fileModified) {
+		editorSetStatusMessage("Nothing to save");
+		return;
+	}
 	
-	free(E.filePath);
-	E.filePath = strdup(filePath);
-	E.filePathLength = strlen(E.filePath);
+	fd = open(E.filePath, O_WRONLY);
+	if (fd == -1) {
+		editorSetStatusMessage("Cant save! I/O error: %s", strerror(errno));
+		return;
+	}
+	
+	while (page < pages) {
+		size_t start, end;
+		
+		if (!editorHexPageDirty(page)) {
+			page++;
+			continue;
+		}
+		start = page * HEX_PAGE_SIZE;
+		while (page < pages && editorHexPageDirty(page)) { page++; }
+		end = page * HEX_PAGE_SIZE;
+		if (end > E.hexSize) { end = E.hexSize; }
+		
+		while (start < end) {
+			ssize_t written = pwrite(fd, &E.hexData[start], end - start, start);
+			
+			if (written <= 0) {
+				editorSetStatusMessage("Cant save! I/O error: %s", strerror(errno));
+				close(fd);
+				return;
+			}
+			start += written;
+		}
+	}
+	close(fd);
 	
-	if (!fp) { die("fopen"); }
+	memset(E.hexDirty, 0, (E.hexSize / HEX_PAGE_SIZE) / 8 + 1);
+	E.fileModified = 0;
+	E.hexSavedUndo = E.hexUndoCount;
+	E.hexChanged = 1;
+	editorSetStatusMessage("Saved file");
+}
 
-	lineLen = getline(&line, &lineCap, fp);
+//leaves the hex view, bytes typed over that werent saved are thrown away with the mapping
+void editorHexClose () {
+	munmap(E.hexData, E.hexSize);
+	close(E.hexFd);
+	E.hexFd = -1;
+	free(E.hexDirty);
+	free(E.hexUndo);
+	E.hexData = NULL;
+	E.hexDirty = NULL;
+	E.hexUndo = NULL;
+	E.hexUndoCount = 0;
+	E.hexUndoCapacity = 0;
+	E.hexSavedUndo = 0;
+	E.hexSize = 0;
+	E.hexActive = 0;
+	E.fileModified = 0;
+	
+	E.cy = HEADER_SIZE;
+	editorSetCursorCol(0);
+	editorClampCursor();
+}
 
-	while (lineLen != -1) {
-		while (lineLen > 0 && (line[lineLen - 1] == '\n' || line[lineLen - 1] == '\r')) {
-			lineLen--;
+void editorHexToggle () {
+	if (E.hexActive) {
+		int changed = E.hexChanged;
+		
+		if (E.hexOnly) {
+			editorSetStatusMessage("The file has nul bytes so it can only be shown as hex");
+			return;
 		}
-			
-		editorInsertRow(E.numberOfRows, line, lineLen);	
-		lineLen = getline(&line, &lineCap, fp);
+		if (E.fileModified) {
+			editorSetStatusMessage("Save the bytes typed over with Ctrl-S or undo them with Ctrl-Z first");
+			return;
+		}
+		editorHexClose();
+		if (changed) { editorReload(); } //only the blocks with changed bytes are read in again
+		return;
 	}
 	
-	free(line);
-	fclose(fp);
+	if (E.filePath == NULL || E.fileCompression != COMPRESSION_NONE) {
+		editorSetStatusMessage("Only a plain file can be shown as hex");
+	} else if (E.fileModified) {
+		editorSetStatusMessage("Save the file before showing it as hex");
+	} else if (editorHexOpen() == -1) {
+		editorSetStatusMessage("Could not map %s", E.filePath);
+	}
 }
 
-//caller should free return value
-char* editorRowsToString (int* bufLength) {
-	int totalLength = 0;
+/*
+	reading a page of the mapping that is past the end of the file kills the editor with SIGBUS,
+	so the size is checked before the view is drawn or used and a file that got smaller is mapped again
+*/
+void editorHexCheckSize () {
+	struct stat st;
+	int modified = E.fileModified;
+	
+	if (!E.hexActive || (fstat(E.hexFd, &st) != -1 && (size_t)st.st_size >= E.hexSize)) { return; }
+	
+	editorHexClose();
+	if (editorHexOpen() == 0) {
+		editorSetStatusMessage("The file got smaller on disk so it was mapped again%s", modified ? ", the bytes typed over were lost" : "");
+	} else if (E.hexOnly) {
+		//there are no rows to go back to, and saving none would empty the file
+		editorSetStatusMessage("The file got smaller on disk and cant be shown as hex any more");
+		editorCloseFile();
+	} else {
+		editorSetStatusMessage("The file got smaller on disk so the hex view was closed");
+	}
+}
+
+int editorHexOffsetDigits () {
+	return E.hexSize > 0xffffffffULL ? 12 : 8;
+}
+
+//keeps the cursor byte on screen and puts the terminal cursor on the half of it being typed
+void editorHexScroll () {
+	size_t lines = E.screenRows - HEADER_SIZE - 1;
+	size_t cursorLine = E.hexCursor / HEX_LINE_BYTES;
+	int byte = E.hexCursor % HEX_LINE_BYTES;
+	
+	if (lines < 1) { lines = 1; }
+	if (cursorLine < E.hexTop / HEX_LINE_BYTES) { E.hexTop = cursorLine * HEX_LINE_BYTES; }
+	if (cursorLine >= E.hexTop / HEX_LINE_BYTES + lines) { E.hexTop = (cursorLine - lines + 1) * HEX_LINE_BYTES; }
+	
+	E.cy = HEADER_SIZE + cursorLine - E.hexTop / HEX_LINE_BYTES;
+	E.cx = LINE_START_SIZE + editorHexOffsetDigits() + 2 + byte * 3 + (byte >= HEX_LINE_BYTES / 2) + E.hexNibble;
+}
+
+//draws one line of offset, hex and ascii columns, reading only its own bytes from the mapping
+void editorHexDrawLine (struct abuf* buff, int y) {
+	size_t offset = E.hexTop + (size_t)y * HEX_LINE_BYTES;
+	char line[128];
+	int length;
 	int i;
 	
-	for (i = 0; i < E.numberOfRows; i++) {
-		totalLength += E.rows[i].length + 1; // "+ 1" is for the new line char	
+	abufAppend(buff, "~ ", LINE_START_SIZE);
+	if (offset >= E.hexSize) { return; }
+	
+	length = snprintf(line, sizeof(line), "%0*zx  ", editorHexOffsetDigits(), offset);
+	for (i = 0; i < HEX_LINE_BYTES; i++) {
+		if (i == HEX_LINE_BYTES / 2) { line[length++] = ' '; }
+		if (offset + i < E.hexSize) {
+			length += snprintf(&line[length], sizeof(line) - length, "%02x ", E.hexData[offset + i]);
+		} else {
+			length += snprintf(&line[length], sizeof(line) - length, "   ");
+		}
 	}
 	
-	*bufLength = totalLength;
+	//a narrow screen cuts the hex off and leaves the ascii out
+	if (length + 2 + HEX_LINE_BYTES + 1 > E.screenCols - LINE_START_SIZE) {
+		abufAppend(buff, line, (length < E.screenCols - LINE_START_SIZE) ? length : E.screenCols - LINE_START_SIZE);
+		return;
+	}
+	abufAppend(buff, line, length);
 	
-	char* buf = malloc(totalLength);
-	char* p = buf; // this is a pointer to where the next line will be added 
-	for (i = 0; i < E.numberOfRows; i++) {
-		memcpy(p, E.rows[i].chars, E.rows[i].length);
-		p += E.rows[i].length;
-		*p = '\n';
-		p++;
+	abufAppend(buff, " |", 2);
+	for (i = 0; i < HEX_LINE_BYTES && offset + i < E.hexSize; i++) {
+		char c = E.hexData[offset + i];
+		int cursor = (offset + i == E.hexCursor);
 		
+		if (c < 32 || c > 126) { c = '.'; }
+		if (cursor) { abufAppend(buff, "\x1b[7m", 4); }
+		abufAppend(buff, &c, 1);
+		if (cursor) { abufAppend(buff, "\x1b[27m", 5); }
 	}
-		
-	return buf;
+	abufAppend(buff, "|", 1);
 }
 
-void editorSave () {
-	if (E.filePath == NULL) {
-		E.filePath = editorPrompt("Save as: %s (ESC to leave)", NULL);
-		if (E.filePath == NULL) { return; }
+void editorHexMarkDirty (size_t offset) {
+	size_t page = offset / HEX_PAGE_SIZE;
+	
+	E.hexDirty[page / 8] |= 1 << (page % 8);
+}
+
+//a page that undo has put back to what is in the file doesnt need writing on the next save
+void editorHexPageCheck (size_t offset) {
+	size_t page = offset / HEX_PAGE_SIZE;
+	size_t start = page * HEX_PAGE_SIZE;
+	size_t length = (start + HEX_PAGE_SIZE > E.hexSize) ? E.hexSize - start : HEX_PAGE_SIZE;
+	char disk[HEX_PAGE_SIZE];
+	int fd;
+	
+	if (!editorHexPageDirty(page)) { return; }
+	fd = open(E.filePath, O_RDONLY);
+	if (fd == -1) { return; }
+	if (pread(fd, disk, length, start) == (ssize_t)length && memcmp(disk, &E.hexData[start], length) == 0) {
+		E.hexDirty[page / 8] &= ~(1 << (page % 8));
 	}
+	close(fd);
+}
+
+//the bytes only differ from the file if undo isnt back where they were saved
+void editorHexUpdateModified () {
+	E.fileModified = (E.hexUndoCount != E.hexSavedUndo);
+}
+
+void editorHexOverwrite (int digit) {
+	unsigned char* byte = &E.hexData[E.hexCursor];
 	
-	int len;
-	char *buf = editorRowsToString(&len);
-	/*
-	0644 is the standard permissions you usually want for text files. 
-	It gives the owner of the file permission to read and write the file, 
-	and everyone else only gets permission to read the file.
-	*/
-	int fd = open(E.filePath, O_RDWR | O_CREAT, 0644); 
+	if (!E.hexWritable) {
+		editorSetStatusMessage("The file is read only");
+		return;
+	}
 	
-	if (fd != -1) {  
+	//the byte is kept once, when its first half is typed
+	if (E.hexNibble == 0) {
+		if (E.hexUndoCount < E.hexSavedUndo) { E.hexSavedUndo = -1; } //the saved bytes cant be got back to by undo now
+		if (E.hexUndoCount == E.hexUndoCapacity) {
+			E.hexUndoCapacity = E.hexUndoCapacity ? E.hexUndoCapacity * 2 : 64;
+			E.hexUndo = realloc(E.hexUndo, sizeof(HexEdit) * E.hexUndoCapacity);
+			if (E.hexUndo == NULL) { die("realloc"); }
+		}
+		E.hexUndo[E.hexUndoCount].offset = E.hexCursor;
+		E.hexUndo[E.hexUndoCount].old = *byte;
+		E.hexUndoCount++;
+	}
+	editorHexMarkDirty(E.hexCursor);
 	
-		if (ftruncate(fd, len) != -1) { //creates file to certain size
-			write(fd, buf, len);
-			close(fd);
-			editorSetStatusMessage("Saved file");
-			E.fileModified = 0;
+	if (E.hexNibble == 0) {
+		*byte = (*byte & 0x0f) | (digit << 4);
+		E.hexNibble = 1;
+	} else {
+		*byte = (*byte & 0xf0) | digit;
+		if (E.hexCursor + 1 < E.hexSize) {
+			E.hexCursor++;
+			E.hexNibble = 0;
 		}
 	}
+	editorHexUpdateModified();
+}
+
+//puts back the last byte typed over, saved bytes can be undone too and are written again on the next save
+void editorHexUndo () {
+	HexEdit* edit;
 	
-	free(buf);
+	if (E.hexUndoCount == 0) {
+		editorSetStatusMessage("Nothing to undo");
+		return;
+	}
+	edit = &E.hexUndo[--E.hexUndoCount];
+	E.hexData[edit->offset] = edit->old;
+	editorHexMarkDirty(edit->offset);
+	editorHexPageCheck(edit->offset);
+	E.hexCursor = edit->offset;
+	E.hexNibble = 0;
+	editorHexUpdateModified();
 }
 
-/**** FIND ****/
+typedef struct HexFindJob {
+	const char* pattern;
+	int length;
+	size_t from; //the part of the mapping to look in
+	size_t to;
+	size_t found[PARALLEL_MAX_THREADS]; //the first match in each threads chunks
+} HexFindJob;
 
-void editorFindCallback(char *query, int key) {
- 	int i;
- 	
-	static int lastMatch = -1;
-	static int direction  =  1;
+void editorHexFindWorker (ParallelJob* pj) {
+	HexFindJob* job = pj->arg;
+	int i;
 	
-	static int savedHlLine;
-	static char* savedHl;
+	job->found[pj->thread] = HEX_NOT_FOUND;
+	for (i = pj->start; i < pj->end; i++) {
+		size_t start = job->from + (size_t)i * HEX_FIND_CHUNK;
+		size_t end = start + HEX_FIND_CHUNK + job->length - 1; //runs over into the next chunk so a match across the edge is found
+		int at;
+		
+		if (end > job->to) { end = job->to; }
+		at = editorFindInText((char*)&E.hexData[start], end - start, job->pattern, job->length);
+		if (at != -1) {
+			job->found[pj->thread] = start + at;
+			return;
+		}
+	}
+}
+
+//the first match that starts in from..to, each thread takes a run of chunks and stops at its first match
+size_t editorHexFindRange (const char* pattern, int length, size_t from, size_t to) {
+	HexFindJob job;
+	int t;
 	
-	int current;
+	if (to < from + length) { return HEX_NOT_FOUND; }
+	job.pattern = pattern;
+	job.length = length;
+	job.from = from;
+	job.to = to;
+	for (t = 0; t < PARALLEL_MAX_THREADS; t++) { job.found[t] = HEX_NOT_FOUND; }
 	
-	if (savedHlLine) {
-		memcpy(E.rows[savedHlLine].hl, savedHl, E.rows[savedHlLine].length); //copies the saved highlighting data back into so its correct colours
-    	free(savedHl);
-    	savedHl = NULL;
-	}
+	editorParallelFor((to - from + HEX_FIND_CHUNK - 1) / HEX_FIND_CHUNK, editorHexFindWorker, &job);
 	
- 	if (key == '\r' || key == '\x1b') {
-		lastMatch = -1;
-		direction = 1;
-		return;
-	} else if (key == ARROW_RIGHT || key == ARROW_DOWN) {
-		debugOutput("find right");
-		direction = 1;
-	} else if (key == ARROW_LEFT || key == ARROW_UP) {
-		direction = -1;
-	} else {
-		lastMatch = -1;
-		direction = 1;
+	//the threads ranges are in order so the first one with a match has the earliest
+	for (t = 0; t < PARALLEL_MAX_THREADS; t++) {
+		if (job.found[t] != HEX_NOT_FOUND) { return job.found[t]; }
 	}
+	return HEX_NOT_FOUND;
+}
+
+//looks from the offset to the end and then wraps round to the start
+size_t editorHexFind (const char* pattern, int length, size_t from) {
+	size_t at;
 	
-	if (lastMatch == -1) { direction = 1; }
-	current = lastMatch;
-	for (i = 0; i < E.numberOfRows; i++) {
-		char* match;
-		EditorRow* row;
+	if (from >= E.hexSize) { from = 0; }
+	at = editorHexFindRange(pattern, length, from, E.hexSize);
+	if (at == HEX_NOT_FOUND && from > 0) {
+		size_t to = from + length - 1;
+		
+		at = editorHexFindRange(pattern, length, 0, to < E.hexSize ? to : E.hexSize);
+	}
+	return at;
+}
+
+//"7f 45 4c 46" is looked for as bytes, anything that isnt pairs of hex digits is looked for as text
+int editorHexParsePattern (const char* query, char* pattern) {
+	int digits = 0;
+	int length = 0;
+	const char* p;
 	
-		current += direction;
-		if (current == -1) { current = E.numberOfRows - 1; }
-		else if (current == E.numberOfRows) { current = 0; }
+	for (p = query; *p; p++) {
+		if (*p == ' ') { continue; }
+		if (!isxdigit((unsigned char)*p)) { break; }
+		digits++;
+	}
+	if (*p || digits == 0 || digits % 2) {
+		strcpy(pattern, query);
+		return strlen(query);
+	}
 	
-		row = &E.rows[current];
-		match = strstr(row->chars, query); //used to find sub string
+	//the spaces are skipped before pairing so "7 f" is one byte 7f and not 07 0f
+	digits = 0;
+	for (p = query; *p; p++) {
+		int nibble;
 		
-		if (match) {
-			lastMatch = current;
-			E.cy = HEADER_SIZE;
-			E.cx = getScreenSpaceFromRawLinePosition(i, match - row->chars);
-      		E.yScroll = current;
+		if (*p == ' ') { continue; }
+		nibble = isdigit((unsigned char)*p) ? *p - '0' : tolower((unsigned char)*p) - 'a' + 10;
+		if (digits++ % 2 == 0) {
+			pattern[length] = nibble << 4;
+		} else {
+			pattern[length++] |= nibble;
+		}
+	}
+	return length;
+}
 
-			savedHlLine = current;
-			savedHl = malloc(row->length);
-			memcpy(savedHl, row->hl, row->length);
-      		
-			memset(&row->hl[match - row->chars], HL_MATCH, strlen(query));
-      		break;
-		}		
-	} 
+void editorHexFindCallback (char* query, int key) {
+	char* pattern;
+	int length;
+	size_t at;
 	
-	return;
+	if (key == '\r' || key == '\x1b' || query[0] == '\0') { return; }
+	
+	pattern = malloc(strlen(query) + 1);
+	if (pattern == NULL) { die("malloc"); }
+	length = editorHexParsePattern(query, pattern);
+	
+	//typing looks again from where the search started, the arrows go on to the next match
+	at = editorHexFind(pattern, length, (key == ARROW_RIGHT || key == ARROW_DOWN) ? E.hexCursor + 1 : E.hexFindStart);
+	if (at != HEX_NOT_FOUND) {
+		E.hexCursor = at;
+		E.hexNibble = 0;
+	}
+	free(pattern);
 }
 
-void editorFind () {
-	int saved_cx = E.cx;
-	int saved_cy = E.cy;
-	int saved_yScroll = E.yScroll;
-	int saved_xScroll = E.xScroll;
-	char* query = editorPrompt("Search: %s (ESC to leave)", editorFindCallback);	
+void editorHexFindPrompt () {
+	char* query;
 	
+	E.hexFindStart = E.hexCursor;
+	query = editorPrompt("Search bytes: %s (hex or text, ESC to leave)", editorHexFindCallback);
 	if (query) {
 		free(query);
 	} else {
-		E.cy = saved_cx;
-		E.cx = saved_cy;
-		E.xScroll = saved_yScroll;
-		E.yScroll = saved_xScroll;
+		E.hexCursor = E.hexFindStart;
 	}
 }
 
+void editorHexProcessKey (int c) {
+	size_t page = (size_t)(E.screenRows - HEADER_SIZE - 1) * HEX_LINE_BYTES;
+	
+	switch (c) {
+		case ARROW_LEFT:
+			if (E.hexNibble == 1) { E.hexNibble = 0; }
+			else if (E.hexCursor > 0) { E.hexCursor--; }
+			break;
+		case ARROW_RIGHT:
+			if (E.hexCursor + 1 < E.hexSize) { E.hexCursor++; }
+			E.hexNibble = 0;
+			break;
+		case ARROW_UP:
+			if (E.hexCursor >= HEX_LINE_BYTES) { E.hexCursor -= HEX_LINE_BYTES; }
+			break;
+		case ARROW_DOWN:
+			if (E.hexCursor + HEX_LINE_BYTES < E.hexSize) { E.hexCursor += HEX_LINE_BYTES; }
+			break;
+		case PAGE_UP:
+			E.hexCursor = (E.hexCursor >= page) ? E.hexCursor - page : E.hexCursor % HEX_LINE_BYTES;
+			break;
+		case PAGE_DOWN:
+			if (E.hexCursor + page < E.hexSize) { E.hexCursor += page; }
+			break;
+		case END:
+			E.hexCursor = E.hexSize - 1;
+			E.hexNibble = 0;
+			break;
+			
+		case CTRL_KEY('s'):
+			editorHexSave();
+			break;
+		case CTRL_KEY('z'):
+			editorHexUndo();
+			break;
+		case CTRL_KEY('f'):
+			editorHexFindPrompt();
+			break;
+		case CTRL_KEY('x'):
+			editorHexToggle();
+			break;
+			
+		default:
+			if (c < 128 && isxdigit(c)) {
+				editorHexOverwrite(isdigit(c) ? c - '0' : tolower(c) - 'a' + 10);
+			}
+			break;
+	}
+}
 
 /**** INPUTS ****/
 
@@ -878,11 +7950,17 @@ void editorFind () {
 	WILL RETURN A STRING!
 */
 char* editorPrompt (char* prompt, void (*callback)(char *, int)) {
+	return editorPromptAllowEmpty(prompt, callback, 0);
+}
+
+//same as editorPrompt but if allowEmpty is set enter on nothing gives back an empty string
+char* editorPromptAllowEmpty (char* prompt, void (*callback)(char *, int), int allowEmpty) {
 	size_t bufferSize = 128;
 	char* buffer = malloc(bufferSize);
 	
 	size_t bufferLength = 0;
 	buffer[0] = '\0';
+	E.promptActive = 1;
 	
 	while (1) {
 		editorSetStatusMessage(prompt, buffer);
@@ -891,15 +7969,19 @@ char* editorPrompt (char* prompt, void (*callback)(char *, int)) {
 		int c = editorKeyRead();
 		debugOutputInt(c);
     	
-    	if (c == '\x1b') {
+    	if (c == REDRAW_KEY) {
+    		continue;
+    	} else if (c == '\x1b') {
     		editorSetStatusMessage("");
-    		if (callback) callback(buffer, bufferLength);
+    		if (callback) callback(buffer, c);
     		free(buffer);
+    		E.promptActive = 0;
     		return NULL;
     	} else if (c == '\r') {
-			if (bufferLength != 0) {
+			if (bufferLength != 0 || allowEmpty) {
 				editorSetStatusMessage("");
-				if (callback) callback(buffer, bufferLength);
+				if (callback) callback(buffer, c);
+				E.promptActive = 0;
 				return buffer;
 			}
 		} else if (c == BACKSPACE) {
@@ -922,22 +8004,22 @@ char* editorPrompt (char* prompt, void (*callback)(char *, int)) {
 void scrollScreenY (int offset) {
 	E.yScroll += offset;
 	if (E.yScroll < 0				) { E.yScroll = 0; }
-	if (E.yScroll > E.numberOfRows) { E.yScroll = E.numberOfRows; }
-}
-
-void scrollScreenX (int offset) {
-	E.xScroll += offset;
-	if (E.xScroll < 0			  ) { E.xScroll = 0; }
-	if (E.xScroll > E.screenCols) { E.xScroll = E.screenCols; }
+	if (E.yScroll > editorVisibleCount()) { E.yScroll = editorVisibleCount(); }
 }
 
 void editorMoveCursor(int key) {
-	int lineLength = E.rows[getCurrentLine()].length;
+	if (editorVisibleCount() == 0) { return; } //rows may not have arrived yet when reading from a pipe, or none match the filter
+	
 	int line = getCurrentLineInFile();
+	EditorRow* row = &E.rows[line];
+	int lineLength = editorRowCols(row);
+	int col = getCursorPositionInRenderdFileLine();
+	int at;
 
     switch (key) {
         case ARROW_LEFT:
-            E.cx--;
+        	//wide charicters and tabs are stepped over in one go
+        	if (col > 0) { col = editorRowPosFromCol(row, col - 1).col; }
             break;
         case ARROW_DOWN:
             E.cy++;
@@ -946,60 +8028,47 @@ void editorMoveCursor(int key) {
             E.cy--;
             break;
         case ARROW_RIGHT:
-            E.cx++;
+        	if (col < lineLength) { col += editorRowCharWidthAtCol(row, col); }
             break;
         case CTRL_ARROW_LEFT:
-        	if (E.cx > lineLength) { E.cx = lineLength + LINE_START_SIZE - 1; break; } 
-        	while (E.cx > 0) {
-        		if (getCurrentSelctedChar() == ' ') { break; }
-        		E.cx--;
-        	}
-        	while (E.cx > 0 && getCurrentSelctedChar() == ' ') {
-        		E.cx--;
-        	}
+        	at = editorRowColToRaw(row, col);
+        	while (at > 0 && editorRowByteAt(row, at - 1) == ' ') { at--; }
+        	while (at > 0 && editorRowByteAt(row, at - 1) != ' ') { at--; }
+        	col = editorRowRawToCol(row, at);
         	break;
         case CTRL_ARROW_RIGHT:
-        	while (E.cx < lineLength - 1 + LINE_START_SIZE) {
-        		if (getCurrentSelctedChar() == ' ') { break; }
-        		E.cx++;
-        	}
-        	while (E.cx < lineLength - 1 + LINE_START_SIZE && getCurrentSelctedChar() == ' ') {
-        		E.cx++;
-        	}
+        	at = editorRowColToRaw(row, col);
+        	while (at < row->rawLength && editorRowByteAt(row, at) != ' ') { at++; }
+        	while (at < row->rawLength && editorRowByteAt(row, at) == ' ') { at++; }
+        	col = editorRowRawToCol(row, at);
         	break;
         case END:
-        	E.cx = lineLength + LINE_START_SIZE;
+        	col = lineLength;
 			break;
     }
-
-	
-
-    if (E.cx < 0) { 
-    	E.cx = 0;
-    	scrollScreenX(-1);
-    }
     
-    if (E.cy < 0) { 
-    	E.cy = 0;
+    if (E.cy < HEADER_SIZE) { 
+    	E.cy = HEADER_SIZE;
     	scrollScreenY(-1);
     }
     
-    if (E.cx > E.screenCols) {
-    	E.cx = E.screenCols;
-    	scrollScreenX(1);
-    }
-    
     if (E.cy > E.screenRows) { 
     	E.cy = E.screenRows;
     	scrollScreenY(1);
     }
     
-    line++;
+    line = E.cy + E.yScroll - HEADER_SIZE; //the visible line, folded rows dont count
+    if (line >= editorVisibleCount()) { //dont let the cursor go past the last row
+    	E.cy -= line - (editorVisibleCount() - 1);
+    }
     line = getCurrentLineInFile();
-	if (getCursorPositionInRenderdFileLine() >= E.rows[line].length) { 
-		lineLength = E.rows[getCurrentLine()].length;
-    	E.cx = lineLength + LINE_START_SIZE;
+    
+	if (col >= editorRowCols(&E.rows[line])) { 
+    	col = editorRowCols(&E.rows[line]);
+    } else if (col > 0) { //dont leave the cursor in the middle of a wide charicter or tab
+    	col = editorRowPosFromCol(&E.rows[line], col).col;
     }
+    editorSetCursorCol(col); //this scrolls sideways if the column is off screen
 }
 
 #define QUIT_ATTEMPTS 3
@@ -1007,9 +8076,25 @@ void editorProcessKeypress () {
 	static short int quitAttempts = QUIT_ATTEMPTS;  
     int c = editorKeyRead();
     
+    if (c != REDRAW_KEY && c != CTRL_KEY('s')) { E.diskConflict = 0; } //the save warning only lasts until the next key
+    if (c != REDRAW_KEY && c != CTRL_KEY('n')) { editorCompleteClear(); } //ctrl-n only goes on to the next word straight after
+    if (!editorSelectionKeepKey(c)) { E.selectActive = 0; }
+    
+    //the hex view has its own keys, only quitting is shared
+    editorHexCheckSize();
+    if (E.hexActive && c != REDRAW_KEY && c != CTRL_KEY('q')) {
+    	editorHexProcessKey(c);
+    	quitAttempts = QUIT_ATTEMPTS;
+    	return;
+    }
+    
     switch (c) {
+    	case REDRAW_KEY:
+    		return; //nothing was pressed, so quit attempts are left alone
+    		
     	case '\r': //enter key
-    		editorInsertNewLine();
+    		if (E.searchQuery) { editorSearchOpenResult(); } //the rows are search results
+    		else { editorInsertNewLine(); }
     		break;
     		
     	case BACKSPACE:
@@ -1017,7 +8102,6 @@ void editorProcessKeypress () {
     		 E.cx--;
 		case DELETE_KEY:
 			editorDeleteChar();
-			E.cx++;
 			break;
     
         case CTRL_KEY('q'):
@@ -1038,6 +8122,63 @@ void editorProcessKeypress () {
 		case CTRL_KEY('f'):
 			editorFind();
 			break;
+		case CTRL_KEY('r'):
+			editorReplace();
+			break;
+		case CTRL_KEY('z'):
+			editorUndo();
+			break;
+		case CTRL_KEY('b'):
+			editorJumpToBracket();
+			break;
+		case CTRL_KEY('k'):
+			editorToggleFold();
+			break;
+		case CTRL_KEY('u'):
+			editorFoldToLine();
+			break;
+		case CTRL_KEY('e'):
+			editorFilter();
+			break;
+		case CTRL_KEY('o'):
+			editorReload();
+			break;
+		case CTRL_KEY('x'):
+			editorHexToggle();
+			break;
+		case CTRL_KEY('w'):
+			editorToggleWrap();
+			break;
+		case CTRL_KEY('p'):
+			editorFuzzyFind();
+			break;
+		case CTRL_KEY('g'):
+			editorSearchDirectory();
+			break;
+		case CTRL_KEY('n'):
+			editorComplete();
+			break;
+		case CTRL_KEY('a'):
+			editorSelectAll();
+			break;
+		case CTRL_KEY('c'):
+			editorCopy();
+			break;
+		case CTRL_KEY('d'):
+			editorCut();
+			break;
+		case CTRL_KEY('v'):
+			editorPaste();
+			break;
+		case CTRL_KEY('y'):
+			editorClipboardWrite();
+			break;
+		case SHIFT_ARROW_UP:
+		case SHIFT_ARROW_DOWN:
+		case SHIFT_ARROW_LEFT:
+		case SHIFT_ARROW_RIGHT:
+			editorSelectMove(c);
+			break;
             
         case ARROW_UP:
         case ARROW_DOWN:
@@ -1049,10 +8190,12 @@ void editorProcessKeypress () {
             editorMoveCursor(c); 
             break;
         case PAGE_UP:
-            scrollScreenY(-1);
+            if (E.wrapActive) { editorWrapScroll(-1); }
+            else { scrollScreenY(-1); }
             break;
         case PAGE_DOWN:
-            scrollScreenY(1);
+            if (E.wrapActive) { editorWrapScroll(1); }
+            else { scrollScreenY(1); }
             break;
             
 		case CTRL_KEY('l'):
@@ -1070,7 +8213,15 @@ void editorProcessKeypress () {
 /**** INIT ****/
 
 int getWindowSize (int* rows, int* cols) {
-    //moves cursor to the bottom right of screen
+	struct winsize ws;
+	
+	if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) != -1 && ws.ws_col != 0) {
+		*rows = ws.ws_row;
+		*cols = ws.ws_col;
+		return 0;
+	}
+	
+    //some terminals cant be asked, so move the cursor to the bottom right of screen and see where it is
     if (write(STDOUT_FILENO, "\x1b[999C\x1b[999B", 12) != 12) {
         return -1;
     }
@@ -1084,6 +8235,7 @@ int getWindowSize (int* rows, int* cols) {
 void initEditor () {
     int rows;
     int cols;
+    int i;
 
     if (getWindowSize(&rows,&cols) == -1) {
         die("getWindowSize");
@@ -1096,35 +8248,155 @@ void initEditor () {
     E.screenRows = rows;
     E.screenCols = cols;
 
-    E.cx = 0;
-    E.cy = 0;
+    E.cx = LINE_START_SIZE;
+    E.cy = HEADER_SIZE;
     E.numberOfRows = 0;
     E.yScroll      = 0;
     E.xScroll      = 0;
     E.rows     = NULL;
+    E.rowsCapacity = 0;
+    E.gapRow = -1;
     E.filePath = NULL;
+    E.fileCompression = COMPRESSION_NONE;
+    E.syntax = NULL;
     E.fileModified = 0;
     
     E.statusMsg[0] = '\0';
   	E.statusMsgTime = 0;
-   
+  	
+  	editorBuildWidthTable();
+  	
+  	pthread_mutex_init(&E.rowsLock, NULL);
+  	E.ingestActive  = 0;
+  	editorInitEvents();
+  	
+  	E.undo = NULL;
+  	E.undoCount = 0;
+  	E.undoCapacity = 0;
+  	E.undoGroup = 0;
+  	E.undoKind = UNDO_EDIT;
+  	E.undoRow = -1;
+  	
+  	E.rowNodes = NULL;
+  	E.rowNodeCount = 0;
+  	E.rowNodeCapacity = 0;
+  	E.rowNodeFree = 0;
+  	E.rowRoot = 0;
+  	E.bracketLine[0] = E.bracketLine[1] = -1;
+  	
+  	E.hiddenRows = 0;
+  	
+  	E.wrapActive = 0;
+  	E.wrapTreeDirty = 1;
+  	E.wrapWidth = 0;
+  	E.wrapTop = 0;
+  	E.wrapYScroll = -1;
+  	E.wrapCursorX = 0;
+  	E.wrapCursorY = 0;
+  	
+  	E.filterActive = 0;
+  	E.filterQuery = NULL;
+  	E.filterRows = NULL;
+  	E.filterCount = 0;
+  	E.filterCapacity = 0;
+  	
+  	E.diskBlocks = NULL;
+  	E.diskBlockCount = 0;
+  	E.diskSize = -1;
+  	E.diskConflict = 0;
+  	
+  	E.hexActive = 0;
+  	
+  	E.fuzzyActive = 0;
+  	E.fuzzyCount = 0;
+  	E.fuzzyMatched = 0;
+  	E.fuzzySelected = 0;
+  	E.fuzzyQuery = NULL;
+  	E.fuzzyGeneration = 0;
+  	
+  	E.searchQuery = NULL;
+  	E.searchActive = 0;
+  	E.searchGeneration = 0;
+  	
+  	E.wordNodes = NULL;
+  	E.wordNodeCount = 0;
+  	E.wordNodeCapacity = 0;
+  	E.wordRoot = 0;
+  	E.wordFree = 0;
+  	E.wordNext = 0;
+  	E.wordTotal = 0;
+  	E.charTotal = 0;
+  	E.completeCount = 0;
+  	E.completeLine = -1;
+  	
+  	E.serverFd = -1;
+  	E.serverPath = NULL;
+  	for (i = 0; i < SERVER_MAX_CLIENTS; i++) { E.serverClients[i].fd = -1; }
+  	E.promptActive = 0;
+  	
+  	E.selectActive = 0;
+  	E.selectRow = 0;
+  	E.selectRaw = 0;
+  	E.clipLines = NULL;
+  	E.clipCount = 0;
+  	E.hexOnly = 0;
+  	E.hexData = NULL;
+  	E.hexSize = 0;
+  	E.hexFd = -1;
+  	E.hexWritable = 0;
+  	E.hexChanged = 0;
+  	E.hexDirty = NULL;
+  	E.hexUndo = NULL;
+  	E.hexUndoCount = 0;
+  	E.hexUndoCapacity = 0;
+  	E.hexSavedUndo = 0;
 }
 
 int main (int argc, char* argv[]) {
+	int streamFd = -1;
+	char* serverPath = NULL;
+	
+	if (argc == 3 && strcmp(argv[1], "--bench-syntax") == 0) {
+		editorSyntaxBenchmark(argv[2]);
+		return 0;
+	}
+	
+	//"editor --server /tmp/sock file" also takes commands from scripts, see SERVER
+	if (argc >= 3 && strcmp(argv[1], "--server") == 0) {
+		serverPath = argv[2];
+		argv += 2;
+		argc -= 2;
+	}
+	
+	//"some_command | editor" or "editor -" reads the document from stdin
+	if (!isatty(STDIN_FILENO) && (argc < 2 || strcmp(argv[1], "-") == 0)) {
+		streamFd = editorReattachTerminal();
+	}
+	
     initEditor();
 	debugOutput("init editor succses");
     enableRawMode();
     debugOutput("enabled raw mode");
     atexit(dissableRawMode);
     
-    if (argc > 1) {
+    //the ui thread only lets go of the rows while it is waiting for a key
+    editorLockRows();
+    editorWordIndexStart(); //it waits for the lock so it starts once the file is open
+    if (serverPath) {
+    	editorServerStart(serverPath);
+    	atexit(editorServerStop);
+    }
+    
+    if (streamFd != -1) {
+    	editorIngestStart(streamFd, COMPRESSION_NONE);
+    } else if (argc > 1) {
         editorOpen(argv[1]);//die("No file given so closed program");
     } else {
     	editorInsertRow(E.numberOfRows, "No File Give New File Made", 27);	
     }
     
     debugOutput("open save editor");
-    editorSetStatusMessage("HELP-Ctrl = Q | quit-Ctrl S to | Ctrl-F = find");
+    if (E.statusMsg[0] == '\0') editorSetStatusMessage("HELP-Ctrl = Q | quit-Ctrl S to | Ctrl-F = find | Ctrl-R = replace | Ctrl-Z = undo | Ctrl-B = bracket"); //unless opening the file had something to say
 
     /*
     reads 1 byte from the standard input untill there 